@@ -29,6 +29,7 @@
 #include "helpers.h"
 #include "duchain/pythoneditorintegrator.h"
 #include "duchain/expressionvisitor.h"
+#include "duchain/contextrangeindex.h"
 #include "duchain/declarationbuilder.h"
 #include "duchain/helpers.h"
 #include "duchain/types/unsuretype.h"
@@ -39,6 +40,7 @@
 #include <language/duchain/classdeclaration.h>
 #include <language/duchain/aliasdeclaration.h>
 #include <language/duchain/duchainutils.h>
+#include <language/duchain/parsingenvironment.h>
 #include <language/util/includeitem.h>
 #include <language/codecompletion/normaldeclarationcompletionitem.h>
 #include <language/codecompletion/codecompletionitem.h>
@@ -51,6 +53,9 @@
 
 #include <QProcess>
 #include <QRegExp>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
 #include <KStandardDirs>
 #include <KTextEditor/View>
 #include <memory>
@@ -70,12 +75,39 @@ PythonCodeCompletionContext::CompletionContextType PythonCodeCompletionContext::
     return m_operation;
 }
 
+namespace {
+    QMutex parsedExpressionsLock;
+    /// Trees of recently evaluated expressions, by expression text; they are not modified by the visitors
+    QCache<QString, CodeAst::Ptr> parsedExpressions(200);
+
+    CodeAst::Ptr parseExpression(const QString& expression)
+    {
+        {
+            QMutexLocker lock(&parsedExpressionsLock);
+            if ( CodeAst::Ptr* cached = parsedExpressions.object(expression) ) {
+                return *cached;
+            }
+        }
+        // Most expressions are simple attribute accesses and calls, which don't need the python parser.
+        CodeAst::Ptr ast = AstBuilder::parseSimpleExpression(expression);
+        if ( ! ast ) {
+            AstBuilder builder;
+            QString code = expression;
+            ast = builder.parse(KUrl(), code);
+        }
+        if ( ast ) {
+            QMutexLocker lock(&parsedExpressionsLock);
+            parsedExpressions.insert(expression, new CodeAst::Ptr(ast));
+        }
+        return ast;
+    }
+}
+
 std::unique_ptr<ExpressionVisitor> visitorForString(QString str, DUContext* context,
                                                     CursorInRevision scanUntil = CursorInRevision::invalid())
 {
     ENSURE_CHAIN_NOT_LOCKED
-    AstBuilder builder;
-    CodeAst::Ptr tmpAst = builder.parse(KUrl(), str);
+    CodeAst::Ptr tmpAst = parseExpression(str);
     if ( ! tmpAst ) {
         return std::unique_ptr<ExpressionVisitor>(nullptr);
     }
@@ -256,23 +288,8 @@ PythonCodeCompletionContext::ItemList PythonCodeCompletionContext::raiseItems()
         kDebug() << "No valid exception classes found, aborting";
         return resultingItems;
     }
-    Declaration* base = declarations.first();
-    IndexedType baseType = base->abstractType()->indexed();
-    QList<DeclarationDepthPair> validDeclarations;
-    ClassDeclaration* current = 0;
-    StructureType::Ptr type;
-    auto decls = m_duContext->topContext()->allDeclarations(CursorInRevision::invalid(), m_duContext->topContext());
-    foreach ( const DeclarationDepthPair d, decls ) {
-        current = dynamic_cast<ClassDeclaration*>(d.first);
-        if ( ! current || ! current->baseClassesSize() ) {
-            continue;
-        }
-        FOREACH_FUNCTION( const BaseClassInstance& base, current->baseClasses ) {
-            if ( base.baseClass == baseType ) {
-                validDeclarations << d;
-            }
-        }
-    }
+    // all exception classes, including those which only inherit from builtin exceptions
+    QList<Declaration*> validDeclarations = Helper::subclassesOf(declarations.first(), m_duContext->topContext());
     auto items = declarationListToItemList(validDeclarations);
     if ( m_itemTypeHint == ClassTypeRequested ) {
         // used for except <cursor>, we don't want the parentheses there
@@ -329,22 +346,59 @@ PythonCodeCompletionContext::ItemList PythonCodeCompletionContext::inheritanceIt
     return resultingItems;
 }
 
-PythonCodeCompletionContext::ItemList PythonCodeCompletionContext::memberAccessItems()
+AbstractType::Ptr PythonCodeCompletionContext::memberAccessType(DUContextPointer context, const QString& expression)
+{
+    auto v = visitorForString(expression, context.data());
+    if ( ! v ) {
+        kWarning() << "Completion requested for syntactically invalid expression, not offering anything";
+        return AbstractType::Ptr();
+    }
+    if ( ! v->lastType() ) {
+        kWarning() << "Did not receive a type from expression visitor! Not offering autocompletion.";
+    }
+    return v->lastType();
+}
+
+void PythonCodeCompletionContext::prepareMemberIndex(DUContextPointer context, AbstractType::Ptr type)
 {
-    ItemList resultingItems;
-    auto v = visitorForString(m_guessTypeOfExpression, m_duContext.data());
     DUChainReadLocker lock;
-    if ( v ) {
-        if ( v->lastType() ) {
-            kDebug() << v->lastType()->toString();
-            resultingItems << getCompletionItemsForType(v->lastType());
-        }
-        else {
-            kWarning() << "Did not receive a type from expression visitor! Not offering autocompletion.";
+    if ( ! context || ! type ) {
+        return;
+    }
+    type = Helper::resolveAliasType(type);
+    QList<AbstractType::Ptr> types;
+    if ( UnsureType::Ptr unsure = type.cast<UnsureType>() ) {
+        for ( uint i = 0; i < unsure->typesSize(); i++ ) {
+            types << Helper::resolveAliasType(unsure->types()[i].abstractType());
         }
     }
     else {
-        kWarning() << "Completion requested for syntactically invalid expression, not offering anything";
+        types << type;
+    }
+    TopDUContext* top = context->topContext();
+    foreach ( const AbstractType::Ptr& current, types ) {
+        StructureType::Ptr cls = StructureType::Ptr::dynamicCast(current);
+        if ( ! cls ) {
+            continue;
+        }
+        foreach ( const DUContext* internal, Helper::internalContextsForClass(cls, top, Helper::PublicOnly) ) {
+            MemberNameIndex::members(internal, top);
+        }
+    }
+}
+
+PythonCodeCompletionContext::ItemList PythonCodeCompletionContext::memberAccessItems()
+{
+    ItemList resultingItems;
+    AbstractType::Ptr type;
+    // the worker might have evaluated the expression already, while it was being typed
+    if ( ! m_worker || ! m_worker->speculatedType(m_duContext, m_guessTypeOfExpression, &type) ) {
+        type = memberAccessType(m_duContext, m_guessTypeOfExpression);
+    }
+    DUChainReadLocker lock;
+    if ( type ) {
+        kDebug() << type->toString();
+        resultingItems << getCompletionItemsForType(type);
     }
 
     // append eventually stripped postfix, for e.g. os.chdir|
@@ -546,9 +600,247 @@ PythonCodeCompletionContext::ItemList PythonCodeCompletionContext::generatorItem
     return resultingItems;
 }
 
+QString PythonCodeCompletionContext::typedPrefix() const
+{
+    int start = m_text.size();
+    while ( start > 0 && ( m_text.at(start - 1).isLetterOrNumber() || m_text.at(start - 1) == '_' ) ) {
+        start--;
+    }
+    return m_text.mid(start);
+}
+
+CompletionRequest PythonCodeCompletionContext::currentRequest(QString* typedPrefix) const
+{
+    *typedPrefix = this->typedPrefix();
+    CompletionRequest request;
+    request.operation = m_operation;
+    request.line = m_position.line;
+    request.fullCompletion = m_fullCompletion;
+    request.baseText = m_text.left(m_text.size() - typedPrefix->size());
+    request.followingText = m_followingText;
+    DUChainReadLocker lock;
+    if ( m_duContext ) {
+        request.context = IndexedDUContext(m_duContext.data());
+        if ( ParsingEnvironmentFilePointer file = m_duContext->topContext()->parsingEnvironmentFile() ) {
+            request.revision = file->modificationRevision();
+        }
+    }
+    return request;
+}
+
 QList<CompletionTreeItemPointer> PythonCodeCompletionContext::completionItems(bool& abort, bool fullCompletion)
 {
     m_fullCompletion = fullCompletion;
+    // While an identifier is being typed, the items of these completion types only depend on the text
+    // before it, so the full result of the previous request is used again for a longer or shorter
+    // identifier. Only the returned items are narrowed down to the identifier.
+    const bool cacheable = m_worker && m_depth == 0
+                           && ( m_operation == MemberAccessCompletion || m_operation == DefaultCompletion
+                                || m_operation == NewStatementCompletion || m_operation == InheritanceCompletion );
+    CompletionRequest request;
+    QString typedPrefix;
+    if ( cacheable ) {
+        request = currentRequest(&typedPrefix);
+        QList<CachedCompletionItem> cachedItems;
+        QList<CachedCompletionGroup> cachedGroups;
+        if ( m_worker->cachedCompletion(request, &cachedItems, &cachedGroups) ) {
+            m_storedGroups = attachedGroups(cachedGroups, typedPrefix);
+            return attachedItems(cachedItems, typedPrefix);
+        }
+    }
+    ItemList resultingItems = computeCompletionItems(abort, fullCompletion);
+    if ( cacheable && ! abort ) {
+        QList<CachedCompletionItem> detachedItems;
+        QList<CachedCompletionGroup> detachedGroups;
+        if ( detachItems(resultingItems, &detachedItems) && detachGroups(m_storedGroups, &detachedGroups) ) {
+            m_worker->storeCompletion(request, detachedItems, detachedGroups);
+        }
+        m_storedGroups = narrowedGroups(m_storedGroups, typedPrefix);
+        resultingItems = narrowedItems(resultingItems, typedPrefix);
+    }
+    return resultingItems;
+}
+
+namespace {
+    /// Only drop declarations which the completion widget would hide anyway: keep every name
+    /// which contains the typed characters in order, which also covers camel case matching.
+    /// Calltips are shown independent of the typed text. The DUChain must be read-locked.
+    bool matchesTypedPrefix(const CompletionTreeItemPointer& item, const QString& typedPrefix)
+    {
+        if ( typedPrefix.isEmpty() ) {
+            return true;
+        }
+        DeclarationPointer declaration = item->declaration();
+        return ! declaration || item->argumentHintDepth() > 0
+               || containsCharactersInOrder(declaration->identifier().toString(), typedPrefix);
+    }
+}
+
+QList<PythonCodeCompletionContext*> PythonCodeCompletionContext::contextChain()
+{
+    QList<PythonCodeCompletionContext*> chain;
+    for ( CodeCompletionContext* context = this; context; context = context->parentContext() ) {
+        chain << static_cast<PythonCodeCompletionContext*>(context);
+    }
+    return chain;
+}
+
+bool PythonCodeCompletionContext::detachItems(const ItemList& items, QList<CachedCompletionItem>* detached)
+{
+    // Calltip items belong to the parent contexts. The text before the cursor is the same
+    // for the next request which uses the cache, so it has the same chain of parents.
+    const QList<PythonCodeCompletionContext*> chain = contextChain();
+    foreach ( const CompletionTreeItemPointer& item, items ) {
+        CachedCompletionItem entry;
+        if ( auto declarationItem = KSharedPtr<PythonDeclarationCompletionItem>::dynamicCast(item) ) {
+            entry.contextDepth = chain.indexOf(static_cast<PythonCodeCompletionContext*>(
+                declarationItem->completionContext().data()
+            ));
+            if ( entry.contextDepth == -1 ) {
+                return false;
+            }
+            entry.matchesSignature = declarationItem->hasMatchAgainst();
+            entry.item = CompletionTreeItemPointer(declarationItem->copyFor(CodeCompletionContext::Ptr(), 0));
+        }
+        else if ( auto keywordItem = KSharedPtr<KeywordItem>::dynamicCast(item) ) {
+            entry.contextDepth = chain.indexOf(static_cast<PythonCodeCompletionContext*>(
+                keywordItem->completionContext().data()
+            ));
+            if ( entry.contextDepth == -1 ) {
+                return false;
+            }
+            entry.item = CompletionTreeItemPointer(keywordItem->copyFor(CodeCompletionContext::Ptr()));
+        }
+        else {
+            // the other items do not refer to a completion context
+            entry.item = item;
+        }
+        detached->append(entry);
+    }
+    return true;
+}
+
+bool PythonCodeCompletionContext::detachGroups(const QList<CompletionTreeElementPointer>& groups,
+                                               QList<CachedCompletionGroup>* detached)
+{
+    foreach ( const CompletionTreeElementPointer& element, groups ) {
+        CompletionCustomGroupNode* group = dynamic_cast<CompletionCustomGroupNode*>(element.data());
+        if ( ! group ) {
+            return false;
+        }
+        ItemList children;
+        foreach ( const CompletionTreeElementPointer& child, group->children ) {
+            if ( ! child->asItem() ) {
+                return false;
+            }
+            children << CompletionTreeItemPointer(child->asItem());
+        }
+        CachedCompletionGroup entry;
+        entry.name = group->roleValue.toString();
+        entry.inheritanceDepth = group->inheritanceDepth;
+        if ( ! detachItems(children, &entry.items) ) {
+            return false;
+        }
+        detached->append(entry);
+    }
+    return true;
+}
+
+PythonCodeCompletionContext::ItemList PythonCodeCompletionContext::attachedItems(
+    const QList<CachedCompletionItem>& items, const QString& typedPrefix)
+{
+    const QList<PythonCodeCompletionContext*> chain = contextChain();
+    ItemList result;
+    DUChainReadLocker lock;
+    foreach ( const CachedCompletionItem& entry, items ) {
+        if ( ! matchesTypedPrefix(entry.item, typedPrefix) ) {
+            continue;
+        }
+        if ( entry.contextDepth == -1 ) {
+            result << entry.item;
+            continue;
+        }
+        PythonCodeCompletionContext* context = chain.value(entry.contextDepth);
+        if ( ! context ) {
+            continue;
+        }
+        if ( auto declarationItem = KSharedPtr<PythonDeclarationCompletionItem>::dynamicCast(entry.item) ) {
+            const IdentifierSignature* matchAgainst = entry.matchesSignature ? &context->m_matchAgainstSignature : 0;
+            result << CompletionTreeItemPointer(declarationItem->copyFor(CodeCompletionContext::Ptr(context),
+                                                                         matchAgainst));
+        }
+        else if ( auto keywordItem = KSharedPtr<KeywordItem>::dynamicCast(entry.item) ) {
+            result << CompletionTreeItemPointer(keywordItem->copyFor(CodeCompletionContext::Ptr(context)));
+        }
+    }
+    return result;
+}
+
+QList<CompletionTreeElementPointer> PythonCodeCompletionContext::attachedGroups(
+    const QList<CachedCompletionGroup>& groups, const QString& typedPrefix)
+{
+    QList<CompletionTreeElementPointer> result;
+    foreach ( const CachedCompletionGroup& group, groups ) {
+        ItemList children = attachedItems(group.items, typedPrefix);
+        if ( children.isEmpty() ) {
+            continue;
+        }
+        CompletionCustomGroupNode* node = new CompletionCustomGroupNode(group.name, group.inheritanceDepth);
+        node->appendChildren(children);
+        result << CompletionTreeElementPointer(node);
+    }
+    return result;
+}
+
+PythonCodeCompletionContext::ItemList PythonCodeCompletionContext::narrowedItems(const ItemList& items,
+                                                                                 const QString& typedPrefix) const
+{
+    if ( typedPrefix.isEmpty() ) {
+        return items;
+    }
+    ItemList result;
+    DUChainReadLocker lock;
+    foreach ( const CompletionTreeItemPointer& item, items ) {
+        if ( matchesTypedPrefix(item, typedPrefix) ) {
+            result << item;
+        }
+    }
+    return result;
+}
+
+QList<CompletionTreeElementPointer> PythonCodeCompletionContext::narrowedGroups(
+    const QList<CompletionTreeElementPointer>& groups, const QString& typedPrefix) const
+{
+    if ( typedPrefix.isEmpty() ) {
+        return groups;
+    }
+    QList<CompletionTreeElementPointer> result;
+    foreach ( const CompletionTreeElementPointer& element, groups ) {
+        CompletionCustomGroupNode* group = dynamic_cast<CompletionCustomGroupNode*>(element.data());
+        if ( ! group ) {
+            result << element;
+            continue;
+        }
+        ItemList children;
+        foreach ( const CompletionTreeElementPointer& child, group->children ) {
+            if ( child->asItem() ) {
+                children << CompletionTreeItemPointer(child->asItem());
+            }
+        }
+        children = narrowedItems(children, typedPrefix);
+        if ( children.isEmpty() ) {
+            continue;
+        }
+        CompletionCustomGroupNode* node = new CompletionCustomGroupNode(group->roleValue.toString(),
+                                                                        group->inheritanceDepth);
+        node->appendChildren(children);
+        result << CompletionTreeElementPointer(node);
+    }
+    return result;
+}
+
+QList<CompletionTreeItemPointer> PythonCodeCompletionContext::computeCompletionItems(bool& abort, bool fullCompletion)
+{
     ItemList resultingItems;
     
     kDebug() << "Line: " << m_position.line;
@@ -607,10 +899,14 @@ QList<CompletionTreeItemPointer> PythonCodeCompletionContext::completionItems(bo
             return ItemList();
         }
         DUChainReadLocker lock;
-        QList<DeclarationDepthPair> declarations = m_duContext->allDeclarations(m_position, m_duContext->topContext());
-        foreach ( const DeclarationDepthPair& d, declarations ) {
-            if ( d.first and d.first->context()->type() == DUContext::Class ) {
-                declarations.removeAll(d);
+        const QList<DeclarationDepthPair> allDeclarations = m_duContext->allDeclarations(m_position,
+                                                                                         m_duContext->topContext());
+        // class members are not visible by their plain name
+        QList<DeclarationDepthPair> declarations;
+        declarations.reserve(allDeclarations.size());
+        foreach ( const DeclarationDepthPair& d, allDeclarations ) {
+            if ( ! d.first || d.first->context()->type() != DUContext::Class ) {
+                declarations.append(d);
             }
         }
         resultingItems.append(declarationListToItemList(declarations));
@@ -679,6 +975,7 @@ QList<CompletionTreeItemPointer> PythonCodeCompletionContext::declarationListToI
     DeclarationPointer currentDeclaration;
     Declaration* checkDeclaration = 0;
     int count = declarations.length();
+    items.reserve(count);
     for ( int i = 0; i < count; i++ ) {
         if ( maxDepth && maxDepth > declarations.at(i).second ) {
             kDebug() << "Skipped completion item because of its depth";
@@ -699,7 +996,8 @@ QList<CompletionTreeItemPointer> PythonCodeCompletionContext::declarationListToI
             item = new PythonDeclarationCompletionItem(currentDeclaration, KDevelop::CodeCompletionContext::Ptr(this));
         }
         if ( ! m_matchAgainst.isEmpty() ) {
-            item->addMatchQuality(identifierMatchQuality(m_matchAgainst, checkDeclaration->identifier().toString()));
+            // only compared when the view asks for the item's match quality
+            item->setMatchAgainst(&m_matchAgainstSignature);
         }
         items << CompletionTreeItemPointer(item);
     }
@@ -732,19 +1030,18 @@ QList< CompletionTreeItemPointer > PythonCodeCompletionContext::getCompletionIte
     // Do some weighting: the more often an entry appears, the better the entry.
     // That way, entries which are in all of the types this object could have will
     // be sorted higher up.
-    QStringList itemTitles;
+    QHash<QString, int> firstItemWithTitle;
     QList<CompletionTreeItemPointer> remove;
     for ( int i = 0; i < result.size(); i++ ) {
         DeclarationPointer decl = result.at(i)->declaration();
         if ( ! decl ) {
-            itemTitles.append(QString());
             continue;
         }
         const QString& title = decl->identifier().toString();
-        if ( itemTitles.contains(title) ) {
+        auto first = firstItemWithTitle.constFind(title);
+        if ( first != firstItemWithTitle.constEnd() ) {
             // there's already an item with that title, increase match quality
-            int item = itemTitles.indexOf(title);
-            PythonDeclarationCompletionItem* declItem = dynamic_cast<PythonDeclarationCompletionItem*>(result[item].data());
+            PythonDeclarationCompletionItem* declItem = dynamic_cast<PythonDeclarationCompletionItem*>(result[*first].data());
             if ( ! m_fullCompletion ) {
                 remove.append(result.at(i));
             }
@@ -753,7 +1050,9 @@ QList< CompletionTreeItemPointer > PythonCodeCompletionContext::getCompletionIte
                 declItem->addMatchQuality(1);
             }
         }
-        itemTitles.append(title);
+        else {
+            firstItemWithTitle.insert(title, i);
+        }
     }
     foreach ( const CompletionTreeItemPointer& ptr, remove ) {
         result.removeOne(ptr);
@@ -764,7 +1063,6 @@ QList< CompletionTreeItemPointer > PythonCodeCompletionContext::getCompletionIte
 QList<CompletionTreeItemPointer> PythonCodeCompletionContext::getCompletionItemsForOneType(AbstractType::Ptr type)
 {
     type = Helper::resolveAliasType(type);
-    ReferencedTopDUContext builtinTopContext = Helper::getDocumentationFileContext();
     if ( type->whichType() != AbstractType::TypeStructure ) {
         return ItemList();
     }
@@ -777,26 +1075,12 @@ QList<CompletionTreeItemPointer> PythonCodeCompletionContext::getCompletionItems
     }
     // the PublicOnly will filter out non-explictly defined __get__ etc. functions inherited from object
     QList<DUContext*> searchContexts = Helper::internalContextsForClass(cls, m_duContext->topContext(), Helper::PublicOnly);
+    // All members are offered: the completion widget filters them, and shows them again when
+    // the identifier typed so far is removed while it is open.
     QList<DeclarationDepthPair> keepDeclarations;
     foreach ( const DUContext* currentlySearchedContext, searchContexts ) {
         kDebug() << "searching context " << currentlySearchedContext->scopeIdentifier() << "for autocompletion items";
-        QList<DeclarationDepthPair> declarations = currentlySearchedContext->allDeclarations(CursorInRevision::invalid(),
-                                                                                                m_duContext->topContext(),
-                                                                                                false);
-        kDebug() << "found" << declarations.length() << "declarations";
-
-        // filter out those which are builtin functions, and those which were imported; we don't want those here
-        // also, discard all magic functions from autocompletion
-        // TODO rework this, it's maybe not the most elegant solution possible
-        // TODO rework the magic functions thing, I want them sorted at the end of the list but KTE doesn't seem to allow that
-        foreach ( const DeclarationDepthPair& current, declarations ) {
-            if ( current.first->context() != builtinTopContext && ! current.first->identifier().identifier().str().startsWith("__") ) {
-                keepDeclarations.append(current);
-            }
-            else {
-                kDebug() << "Discarding declaration " << current.first->toString();
-            }
-        }
+        keepDeclarations.append(MemberNameIndex::members(currentlySearchedContext, m_duContext->topContext()));
     }
     return declarationListToItemList(keepDeclarations);
 }
@@ -972,6 +1256,7 @@ PythonCodeCompletionContext::PythonCodeCompletionContext(DUContextPointer contex
     , m_operation(FunctionCallCompletion)
     , m_itemTypeHint(NoHint)
     , m_child(child)
+    , m_worker(nullptr)
     , m_guessTypeOfExpression(calledFunction)
     , m_alreadyGivenParametersCount(alreadyGivenParameters)
     , m_fullCompletion(false)
@@ -1025,19 +1310,62 @@ void PythonCodeCompletionContext::summonParentForEventualCall(TokenList allExpre
 }
 
 // decide what kind of completion will be offered based on the code before the current cursor position
+DUContext* PythonCodeCompletionContext::contextForCompletion(DUContext* context, const FileIndentInformation& indents,
+                                                             int expressionLine, const CursorInRevision& position)
+{
+    ENSURE_CHAIN_READ_LOCKED
+    // The following code will check whether the DUContext directly at the cursor should be used, or a previous one.
+    // The latter might be the case if there's code like this:
+    /* class foo():
+     * ..pass
+     * .
+     * ..# completion requested here; note that there's less indent in the previous line!
+     * */
+    // In that case, the DUContext of "foo" would end at line 2, but should still be used for completion.
+    DUContext* currentlyChecked = context;
+    QSharedPointer<const ContextRangeIndex> contextIndex = ContextRangeIndex::forTopContext(context->topContext());
+    // skips all the lines which are still in the context at the cursor at once
+    const int lineOutside = contextIndex->lastLineOutside(context, expressionLine);
+    if ( lineOutside >= 0 ) {
+        currentlyChecked = contextIndex->contextAt(CursorInRevision(lineOutside, 0), true);
+    }
+    while ( currentlyChecked && context->parentContextOf(currentlyChecked) ) {
+        kDebug() << "checking:" << currentlyChecked->range() << currentlyChecked->type();
+        // FIXME: "<=" is not really good, it must be exactly one indent-level less
+        int offset = position.line-currentlyChecked->range().start.line;
+        // If the check leaves the current context, abort.
+        if ( offset >= indents.linesCount() ) {
+            break;
+        }
+        if (    indents.indentForLine(indents.linesCount()-1-offset)
+             <= indents.indentForLine(indents.linesCount()-1) )
+        {
+            kDebug() << "changing context to" << currentlyChecked->range() 
+                     << ( currentlyChecked->type() == DUContext::Class );
+            return currentlyChecked;
+        }
+        currentlyChecked = currentlyChecked->parentContext();
+    }
+    return context;
+}
+
 PythonCodeCompletionContext::PythonCodeCompletionContext(DUContextPointer context, const QString& text,
                                                          const QString& followingText,
                                                          const KDevelop::CursorInRevision& position,
-                                                         int depth, const PythonCodeCompletionWorker* /*parent*/)
+                                                         int depth, const PythonCodeCompletionWorker* parent)
     : CodeCompletionContext(context, text, position, depth)
     , m_operation(PythonCodeCompletionContext::DefaultCompletion)
     , m_itemTypeHint(NoHint)
     , m_child(0)
+    , m_worker(parent)
     , m_followingText(followingText)
     , m_position(position)
 {
     m_workingOnDocument = context->topContext()->url().toUrl();
-    QString textWithoutStrings = CodeHelpers::killStrings(text);
+    const CompletionTextCache::Information textInformation = CompletionTextCache::information(
+        context->topContext()->url(), text
+    );
+    const QString& textWithoutStrings = textInformation.textWithoutStrings;
     
     kDebug() << text << position << context->localScopeIdentifier().toString() << context->range();
     
@@ -1062,47 +1390,16 @@ PythonCodeCompletionContext::PythonCodeCompletionContext(DUContextPointer contex
     allExpressions.reset(1);
     ExpressionParser::Status firstStatus = allExpressions.last().status;
     
-    // TODO reuse already calculated information
-    FileIndentInformation indents(text);
+    FileIndentInformation indents(textInformation.indents);
     
-    DUContext* currentlyChecked = context.data();
     // This will set the line to use for the completion to the beginning of the expression.
     // In reality, the line we're in might mismatch the beginning of the current expression,
     // for example in multi-line list initializers.
     int currentlyCheckedLine = position.line - text.mid(text.length() - allExpressions.first().charOffset).count('\n');
     
-    // The following code will check whether the DUContext directly at the cursor should be used, or a previous one.
-    // The latter might be the case if there's code like this:
-    /* class foo():
-     * ..pass
-     * .
-     * ..# completion requested here; note that there's less indent in the previous line!
-     * */
-    // In that case, the DUContext of "foo" would end at line 2, but should still be used for completion.
     {
         DUChainReadLocker lock(DUChain::lock());
-        while ( currentlyChecked == context.data() && currentlyCheckedLine >= 0 ) {
-            currentlyChecked = context->topContext()->findContextAt(CursorInRevision(currentlyCheckedLine, 0), true);
-            currentlyCheckedLine -= 1;
-        }
-        while ( currentlyChecked && context->parentContextOf(currentlyChecked) ) {
-            kDebug() << "checking:" << currentlyChecked->range() << currentlyChecked->type();
-            // FIXME: "<=" is not really good, it must be exactly one indent-level less
-            int offset = position.line-currentlyChecked->range().start.line;
-            // If the check leaves the current context, abort.
-            if ( offset >= indents.linesCount() ) {
-                break;
-            }
-            if (    indents.indentForLine(indents.linesCount()-1-offset)
-                 <= indents.indentForLine(indents.linesCount()-1) )
-            {
-                kDebug() << "changing context to" << currentlyChecked->range() 
-                        << ( currentlyChecked->type() == DUContext::Class );
-                context = currentlyChecked;
-                break;
-            }
-            currentlyChecked = currentlyChecked->parentContext();
-        }
+        context = DUContextPointer(contextForCompletion(context.data(), indents, currentlyCheckedLine, position));
     }
     
     m_duContext = context;
@@ -1305,6 +1602,7 @@ PythonCodeCompletionContext::PythonCodeCompletionContext(DUContextPointer contex
     if ( firstStatus == ExpressionParser::EqualsFound && allExpressions.length() >= 2 ) {
         m_operation = DefaultCompletion;
         m_matchAgainst = allExpressions.at(allExpressions.length() - 2).expression;
+        m_matchAgainstSignature = IdentifierSignature(m_matchAgainst);
     }
 }
 
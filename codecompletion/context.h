@@ -40,6 +40,8 @@ namespace KDevelop {
 
 namespace Python {
     
+class FileIndentInformation;
+
 typedef QPair<Declaration*, int> DeclarationDepthPair;
 
 /**
@@ -96,6 +98,27 @@ public:
     virtual QList< KDevelop::CompletionTreeItemPointer > completionItems(bool& abort, bool fullCompletion = true);
 
     virtual QList< CompletionTreeElementPointer > ungroupedElements();
+
+    /**
+     * @brief Evaluate the type of @p expression in @p context, as member access completion does.
+     * The DUChain must not be locked.
+     **/
+    static AbstractType::Ptr memberAccessType(DUContextPointer context, const QString& expression);
+    /**
+     * @brief Build the member indices which member access completion on @p type in @p context will use.
+     * The DUChain must not be locked.
+     **/
+    static void prepareMemberIndex(DUContextPointer context, AbstractType::Ptr type);
+    /**
+     * @brief Get the context completion uses when @p context was found at @p position.
+     *
+     * This is a context which ends before the cursor if the cursor's line is indented like its body.
+     * @param indents the indents of the text up to @p position
+     * @param expressionLine the line where the expression being completed starts
+     * The DUChain must be read-locked.
+     **/
+    static DUContext* contextForCompletion(DUContext* context, const FileIndentInformation& indents,
+                                           int expressionLine, const KDevelop::CursorInRevision& position);
     
     /**
      * @brief Get all possible items matching the specified dot-seperated search string.
@@ -141,6 +164,13 @@ private:
     QList< CompletionTreeItemPointer > getMissingIncludeItems(QString forString);
     void eventuallyAddGroup(QString name, int priority, QList<CompletionTreeItemPointer> items);
 
+    /// What the result of completionItems() depends on, and the part of the identifier typed so far
+    CompletionRequest currentRequest(QString* typedPrefix) const;
+    /// The part of the identifier at the end of the text which is typed so far
+    QString typedPrefix() const;
+    /// Compute the items of this context from scratch; see completionItems().
+    QList<CompletionTreeItemPointer> computeCompletionItems(bool& abort, bool fullCompletion);
+
 private:
     /// Item generating functions
     using ItemList = QList<CompletionTreeItemPointer>;
@@ -155,6 +185,24 @@ private:
     ItemList stringFormattingItems();
     ItemList keywordItems();
     ItemList classMemberInitItems();
+    /// Remove the declaration items from @p items which can not match @p typedPrefix.
+    ItemList narrowedItems(const ItemList& items, const QString& typedPrefix) const;
+    /// Same as narrowedItems() for the children of @p groups; groups without children are dropped.
+    QList<CompletionTreeElementPointer> narrowedGroups(const QList<CompletionTreeElementPointer>& groups,
+                                                       const QString& typedPrefix) const;
+    /// This context and its parents, starting with this one
+    QList<PythonCodeCompletionContext*> contextChain();
+    /// Copy @p items so they don't keep this context or its parents alive, for the worker's cache.
+    /// Returns false if some item can not be detached; @p detached is incomplete then.
+    bool detachItems(const ItemList& items, QList<CachedCompletionItem>* detached);
+    /// Same as detachItems() for the children of @p groups.
+    bool detachGroups(const QList<CompletionTreeElementPointer>& groups, QList<CachedCompletionGroup>* detached);
+    /// The cached @p items which can match @p typedPrefix, as items of this context and its parents.
+    /// Only those are copied; the others are left out before anything is done with them.
+    ItemList attachedItems(const QList<CachedCompletionItem>& items, const QString& typedPrefix);
+    /// Same as attachedItems() for the children of @p groups; groups without children are dropped.
+    QList<CompletionTreeElementPointer> attachedGroups(const QList<CachedCompletionGroup>& groups,
+                                                       const QString& typedPrefix);
 
 private:
     CompletionContextType m_operation;
@@ -166,6 +214,8 @@ private:
     KUrl m_workingOnDocument;
     
     CodeCompletionContext* m_child;
+    /// null for calltip contexts and in the tests
+    const PythonCodeCompletionWorker* m_worker;
     
     QString m_guessTypeOfExpression;
     QString m_followingText;
@@ -177,6 +227,7 @@ private:
     int m_alreadyGivenParametersCount;
 
     QString m_matchAgainst;
+    IdentifierSignature m_matchAgainstSignature;
 
     bool m_fullCompletion;
 
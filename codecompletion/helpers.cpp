@@ -26,14 +26,23 @@
 #include <language/duchain/duchainutils.h>
 #include <language/duchain/ducontext.h>
 #include <language/duchain/declaration.h>
+#include <language/duchain/indexedducontext.h>
+#include <language/duchain/parsingenvironment.h>
+#include <language/duchain/topducontext.h>
 #include <language/duchain/types/functiontype.h>
 #include <language/duchain/types/integraltype.h>
 #include <language/codecompletion/normaldeclarationcompletionitem.h>
 
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
 #include <QStringList>
 #include <QTextFormat>
+#include <QThreadStorage>
 
 #include "duchain/declarations/functiondeclaration.h"
+#include "duchain/helpers.h"
 #include "parser/codehelpers.h"
 
 using namespace KDevelop;
@@ -55,50 +64,120 @@ QString camelCaseToUnderscore(const QString& camelCase)
 
 int identifierMatchQuality(const QString& identifier1_, const QString& identifier2_)
 {
-    QString identifier1 = camelCaseToUnderscore(identifier1_).toLower().replace('.', '_');
-    QString identifier2 = camelCaseToUnderscore(identifier2_).toLower().replace('.', '_');
+    return IdentifierSignature(identifier1_).matchQuality(IdentifierSignature(identifier2_));
+}
+
+namespace {
+
+// Each completion worker ranks its items in its own thread, so each thread keeps its own cache;
+// the least recently used signatures are dropped first.
+const int maxCachedSignatures = 5000;
+QThreadStorage<QCache<uint, IdentifierSignature>*> signatureCaches;
 
-    if ( identifier1 == identifier2 ) {
+}
+
+IdentifierSignature::IdentifierSignature(const QString& identifier)
+    : m_normalized(camelCaseToUnderscore(identifier).toLower().replace('.', '_'))
+{
+    QStringList parts = m_normalized.split('_', QString::SkipEmptyParts);
+    parts.removeDuplicates();
+    m_partCount = parts.size();
+    foreach ( const QString& part, parts ) {
+        // Don't take very short name parts into account,
+        // those are not very descriptive eventually
+        if ( part.size() >= 3 ) {
+            m_parts.append(qMakePair(qHash(part), part));
+        }
+    }
+    std::sort(m_parts.begin(), m_parts.end());
+}
+
+IdentifierSignature IdentifierSignature::forIdentifier(const IndexedString& identifier)
+{
+    if ( ! signatureCaches.hasLocalData() ) {
+        signatureCaches.setLocalData(new QCache<uint, IdentifierSignature>(maxCachedSignatures));
+    }
+    QCache<uint, IdentifierSignature>* cache = signatureCaches.localData();
+    if ( const IdentifierSignature* cached = cache->object(identifier.index()) ) {
+        return *cached;
+    }
+    IdentifierSignature signature(identifier.str());
+    cache->insert(identifier.index(), new IdentifierSignature(signature));
+    return signature;
+}
+
+int IdentifierSignature::matchQuality(const IdentifierSignature& other) const
+{
+    if ( m_normalized == other.m_normalized ) {
         return 3;
     }
-    if ( identifier1.contains(identifier2) || identifier2.contains(identifier1) ) {
+    if ( m_normalized.contains(other.m_normalized) || other.m_normalized.contains(m_normalized) ) {
         return 2;
     }
-    QStringList parts1 = identifier1.split('_');
-    QStringList parts2 = identifier2.split('_');
-    parts1.removeAll("");
-    parts2.removeAll("");
-    parts1.removeDuplicates();
-    parts2.removeDuplicates();
-    if ( parts1.length() > 5 || parts2.length() > 5 ) {
+    if ( m_partCount > 5 || other.m_partCount > 5 ) {
         // don't waste time comparing huge identifiers,
         // the matching is probably pointless anyways for people using
         // more than 5 words for their variable names
         return 0;
     }
-    foreach ( const QString& part1, parts1 ) {
-        foreach ( const QString& part2, parts2 ) {
-            // Don't take very short name parts into account,
-            // those are not very descriptive eventually
-            if ( part1.size() < 3 || part2.size() < 3 ) {
-                continue;
-            }
-            if ( part1 == part2 ) {
-                // partial match
-                return 1;
-            }
+    // both lists are sorted, so walk them in parallel
+    auto mine = m_parts.constBegin();
+    auto theirs = other.m_parts.constBegin();
+    while ( mine != m_parts.constEnd() && theirs != other.m_parts.constEnd() ) {
+        if ( *mine == *theirs ) {
+            // partial match
+            return 1;
+        }
+        if ( *mine < *theirs ) {
+            mine++;
+        }
+        else {
+            theirs++;
         }
     }
     return 0;
 }
 
-typedef QPair<QString, ExpressionParser::Status> keyword;
+namespace {
+
+struct Keyword {
+    const char* text;
+    ExpressionParser::Status status;
+};
+
+// These tables are constant, so all completion threads can read them without locking.
+const Keyword supportedKeywords[] = {
+    { "import", ExpressionParser::ImportFound },
+    { "from", ExpressionParser::FromFound },
+    { "raise", ExpressionParser::RaiseFound },
+    { "in", ExpressionParser::InFound },
+    { "for", ExpressionParser::ForFound },
+    { "class", ExpressionParser::ClassFound },
+    { "def", ExpressionParser::DefFound },
+    { "except", ExpressionParser::ExceptFound }
+};
+
+const Keyword controlChars[] = {
+    { ":", ExpressionParser::ColonFound },
+    { ",", ExpressionParser::CommaFound },
+    { "(", ExpressionParser::InitializerFound },
+    { "{", ExpressionParser::InitializerFound },
+    { "[", ExpressionParser::InitializerFound },
+    { ".", ExpressionParser::MemberAccessFound },
+    { "=", ExpressionParser::EqualsFound }
+};
+
+const char* const miscKeywords[] = {
+    "and", "assert", "del", "elif", "exec", "if", "is", "not",
+    "or", "print", "return", "while", "yield", "with"
+};
+
+const char* const noCompletionKeywords[] = {
+    "break", "class", "continue", "pass", "try",
+    "else", "as", "finally", "global", "lambda"
+};
 
-static QList<keyword> supportedKeywords;
-static QList<keyword> controlChars;
-static QList<QString> miscKeywords;
-static QList<QString> noCompletionKeywords;
-static QMutex keywordPopulationLock;
+}
 
 // Keywords known to me:
 // and       del       for       is        raise    
@@ -112,29 +191,6 @@ ExpressionParser::ExpressionParser(QString code)
     : m_code(code)
     , m_cursorPositionInString(m_code.length())
 {
-    keywordPopulationLock.lock();
-    if ( supportedKeywords.isEmpty() ) {
-        noCompletionKeywords << "break" << "class" << "continue" << "pass" << "try"
-                             << "else" << "as" << "finally" << "global" << "lambda";
-        miscKeywords << "and" << "assert" << "del" << "elif" << "exec" << "if" << "is" << "not" 
-                     << "or" << "print" << "return" << "while" << "yield" << "with";
-        supportedKeywords << keyword("import", ExpressionParser::ImportFound);
-        supportedKeywords << keyword("from", ExpressionParser::FromFound);
-        supportedKeywords << keyword("raise", ExpressionParser::RaiseFound);
-        supportedKeywords << keyword("in", ExpressionParser::InFound);
-        supportedKeywords << keyword("for", ExpressionParser::ForFound);
-        supportedKeywords << keyword("class", ExpressionParser::ClassFound);
-        supportedKeywords << keyword("def", ExpressionParser::DefFound);
-        supportedKeywords << keyword("except", ExpressionParser::ExceptFound);
-        controlChars << keyword(":", ExpressionParser::ColonFound);
-        controlChars << keyword(",", ExpressionParser::CommaFound);
-        controlChars << keyword("(", ExpressionParser::InitializerFound);
-        controlChars << keyword("{", ExpressionParser::InitializerFound);
-        controlChars << keyword("[", ExpressionParser::InitializerFound);
-        controlChars << keyword(".", ExpressionParser::MemberAccessFound);
-        controlChars << keyword("=", ExpressionParser::EqualsFound);
-    }
-    keywordPopulationLock.unlock();
 }
 
 QString ExpressionParser::getRemainingCode()
@@ -202,16 +258,16 @@ TokenList ExpressionParser::popAll()
     return items;
 }
 
-bool endsWithSeperatedKeyword(const QString& str, const QString& shouldEndWith) {
+bool endsWithSeperatedKeyword(const QString& str, const QLatin1String& shouldEndWith) {
     bool endsWith = str.endsWith(shouldEndWith);
     if ( ! endsWith ) {
         return false;
     }
-    int l = shouldEndWith.length();
+    int l = shouldEndWith.size();
     if ( str.length() == l ) {
         return true;
     }
-    if ( str.right(l + 1).at(0).isSpace() ) {
+    if ( str.at(str.length() - l - 1).isSpace() ) {
         return true;
     }
     return false;
@@ -221,11 +277,12 @@ QString ExpressionParser::popExpression(ExpressionParser::Status* status)
 {
     QString operatingOn = getRemainingCode().trimmed().replace('\t', ' ');
     bool lineIsEmpty = false;
-    for ( QString::const_iterator it = getRemainingCode().constEnd()-1; it != getRemainingCode().constEnd(); it-- ) {
-        if ( ! it->isSpace() ) {
+    for ( int index = m_cursorPositionInString - 1; index >= 0; index-- ) {
+        const QChar c = m_code.at(index);
+        if ( ! c.isSpace() ) {
             break;
         }
-        if ( *it == '\n' ) {
+        if ( c == '\n' ) {
             lineIsEmpty = true;
             break;
         }
@@ -235,7 +292,7 @@ QString ExpressionParser::popExpression(ExpressionParser::Status* status)
         *status = NothingFound;
         return QString();
     }
-    bool lastCharIsSpace = getRemainingCode().right(1).at(0).isSpace();
+    bool lastCharIsSpace = m_code.at(m_cursorPositionInString - 1).isSpace();
     m_cursorPositionInString -= trailingWhitespace();
     if ( operatingOn.endsWith('(') ) {
         kDebug() << "eventual call found";
@@ -243,31 +300,31 @@ QString ExpressionParser::popExpression(ExpressionParser::Status* status)
         *status = EventualCallFound;
         return QString();
     }
-    foreach ( const keyword& kw, controlChars ) {
-        if ( operatingOn.endsWith(kw.first) ) {
-            m_cursorPositionInString -= kw.first.length();
-            *status = kw.second;
+    for ( const Keyword& kw: controlChars ) {
+        if ( operatingOn.endsWith(QLatin1String(kw.text)) ) {
+            m_cursorPositionInString -= qstrlen(kw.text);
+            *status = kw.status;
             return QString();
         }
     }
     if ( lastCharIsSpace ) {
-        foreach ( const keyword& kw, supportedKeywords ) {
-            if ( endsWithSeperatedKeyword(operatingOn, kw.first) ) {
-                m_cursorPositionInString -= kw.first.length();
-                *status = kw.second;
+        for ( const Keyword& kw: supportedKeywords ) {
+            if ( endsWithSeperatedKeyword(operatingOn, QLatin1String(kw.text)) ) {
+                m_cursorPositionInString -= qstrlen(kw.text);
+                *status = kw.status;
                 return QString();
             }
         }
-        foreach ( const QString& kw, miscKeywords ) {
-            if ( endsWithSeperatedKeyword(operatingOn, kw) ) {
-                m_cursorPositionInString -= kw.length();
+        for ( const char* kw: miscKeywords ) {
+            if ( endsWithSeperatedKeyword(operatingOn, QLatin1String(kw)) ) {
+                m_cursorPositionInString -= qstrlen(kw);
                 *status = MeaninglessKeywordFound;
                 return QString();
             }
         }
-        foreach ( const QString& kw, noCompletionKeywords ) {
-            if ( endsWithSeperatedKeyword(operatingOn, kw) ) {
-                m_cursorPositionInString -= kw.length();
+        for ( const char* kw: noCompletionKeywords ) {
+            if ( endsWithSeperatedKeyword(operatingOn, QLatin1String(kw)) ) {
+                m_cursorPositionInString -= qstrlen(kw);
                 *status = NoCompletionKeywordFound;
                 return QString();
             }
@@ -289,6 +346,207 @@ QString ExpressionParser::popExpression(ExpressionParser::Status* status)
 }
 
 
+namespace {
+
+struct CachedText {
+    QString text;
+    QString textWithoutStrings;
+    /// start and length of each string in text
+    QList<QPair<int, int>> strings;
+    /// the first quote in text which does not start a string; a later edit could close it
+    int firstStrayQuote = 0;
+    QList<int> indents;
+    QList<int> lineStarts;
+};
+
+const int maxCachedDocuments = 16;
+QHash<IndexedString, CachedText> cachedTexts;
+QMutex cachedTextsLock;
+
+}
+
+CompletionTextCache::Information CompletionTextCache::information(const IndexedString& document, const QString& text)
+{
+    QMutexLocker lock(&cachedTextsLock);
+    if ( cachedTexts.size() >= maxCachedDocuments && ! cachedTexts.contains(document) ) {
+        cachedTexts.clear();
+    }
+    CachedText& cached = cachedTexts[document];
+
+    int common = 0;
+    const int maxCommon = qMin(text.length(), cached.text.length());
+    while ( common < maxCommon && text.at(common) == cached.text.at(common) ) {
+        common++;
+    }
+
+    // Strings which end before the first change are still found in the same way,
+    // unless an unterminated quote before them could now be closed after the change.
+    const int reusableUntil = qMin(common, cached.firstStrayQuote);
+    int keptStrings = 0;
+    int removedChars = 0;
+    while ( keptStrings < cached.strings.size() ) {
+        const QPair<int, int>& string = cached.strings.at(keptStrings);
+        if ( string.first + string.second > reusableUntil ) {
+            break;
+        }
+        removedChars += string.second - 3;
+        keptStrings++;
+    }
+    int position = keptStrings ? cached.strings.at(keptStrings - 1).first + cached.strings.at(keptStrings - 1).second : 0;
+    cached.strings.erase(cached.strings.begin() + keptStrings, cached.strings.end());
+    cached.textWithoutStrings.truncate(position - removedChars);
+    cached.firstStrayQuote = text.length();
+    auto appendCode = [&](int until) {
+        for ( int i = position; i < until && cached.firstStrayQuote == text.length(); i++ ) {
+            if ( text.at(i) == '"' || text.at(i) == '\'' ) {
+                cached.firstStrayQuote = i;
+            }
+        }
+        cached.textWithoutStrings.append(text.midRef(position, until - position));
+    };
+    foreach ( const QPair<int, int>& string, CodeHelpers::findStrings(text, position) ) {
+        appendCode(string.first);
+        cached.textWithoutStrings.append("\"S\"");
+        cached.strings.append(string);
+        position = string.first + string.second;
+    }
+    appendCode(text.length());
+
+    // Lines which end before the first change keep their indent.
+    int keptLines = 0;
+    while ( keptLines + 1 < cached.lineStarts.size() && cached.lineStarts.at(keptLines + 1) <= common ) {
+        keptLines++;
+    }
+    int lineStart = keptLines < cached.lineStarts.size() ? cached.lineStarts.at(keptLines) : 0;
+    cached.indents.erase(cached.indents.begin() + keptLines, cached.indents.end());
+    cached.lineStarts.erase(cached.lineStarts.begin() + keptLines, cached.lineStarts.end());
+    forever {
+        int lineEnd = text.indexOf('\n', lineStart);
+        if ( lineEnd == -1 ) {
+            lineEnd = text.length();
+        }
+        int indent = lineStart;
+        while ( indent < lineEnd && text.at(indent).isSpace() ) {
+            indent++;
+        }
+        cached.lineStarts.append(lineStart);
+        cached.indents.append(indent - lineStart);
+        if ( lineEnd == text.length() ) {
+            break;
+        }
+        lineStart = lineEnd + 1;
+    }
+
+    cached.text = text;
+    Information information;
+    information.textWithoutStrings = cached.textWithoutStrings;
+    information.indents = cached.indents;
+    return information;
+}
+
+bool containsCharactersInOrder(const QString& name, const QString& characters)
+{
+    int matched = 0;
+    for ( int i = 0; i < name.size() && matched < characters.size(); i++ ) {
+        if ( name.at(i).toLower() == characters.at(matched).toLower() ) {
+            matched++;
+        }
+    }
+    return matched == characters.size();
+}
+
+namespace {
+
+struct IndexedMember {
+    IndexedDeclaration declaration;
+    int depth;
+};
+
+struct MemberIndexEntry {
+    /// revisions of the documents the members are declared in, when the entry was built
+    QList<QPair<IndexedTopDUContext, ModificationRevision>> revisions;
+    QVector<IndexedMember> members;
+};
+
+/// the top context and local index of the searched context, and the index of the top context searched from
+typedef QPair<QPair<uint, uint>, uint> MemberIndexKey;
+
+const int maxMemberIndexEntries = 200;
+QHash<MemberIndexKey, MemberIndexEntry> memberIndexes;
+QMutex memberIndexesLock;
+
+ModificationRevision revisionOf(const TopDUContext* top)
+{
+    if ( ParsingEnvironmentFilePointer file = top->parsingEnvironmentFile() ) {
+        return file->modificationRevision();
+    }
+    return ModificationRevision();
+}
+
+bool isUpToDate(const MemberIndexEntry& entry)
+{
+    typedef QPair<IndexedTopDUContext, ModificationRevision> Revision;
+    foreach ( const Revision& revision, entry.revisions ) {
+        const TopDUContext* top = revision.first.data();
+        if ( ! top || revisionOf(top) != revision.second ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MemberIndexEntry buildMemberIndex(const DUContext* context, const TopDUContext* top)
+{
+    MemberIndexEntry entry;
+    const DUContext* builtinTopContext = Helper::getDocumentationFileContext().data();
+    QSet<TopDUContext*> documents;
+    documents.insert(context->topContext());
+    const QList<DeclarationDepthPair> declarations = context->allDeclarations(CursorInRevision::invalid(), top, false);
+    entry.members.reserve(declarations.size());
+    foreach ( const DeclarationDepthPair& current, declarations ) {
+        // filter out those which are builtin functions, and those which were imported; we don't want those here
+        // also, discard all magic functions from autocompletion
+        // TODO rework the magic functions thing, I want them sorted at the end of the list but KTE doesn't seem to allow that
+        const QString name = current.first->identifier().identifier().str();
+        if ( current.first->context() == builtinTopContext || name.startsWith("__") ) {
+            continue;
+        }
+        IndexedMember member;
+        member.declaration = IndexedDeclaration(current.first);
+        member.depth = current.second;
+        entry.members.append(member);
+        documents.insert(current.first->topContext());
+    }
+    foreach ( TopDUContext* document, documents ) {
+        entry.revisions.append(qMakePair(IndexedTopDUContext(document), revisionOf(document)));
+    }
+    return entry;
+}
+
+}
+
+QList<DeclarationDepthPair> MemberNameIndex::members(const DUContext* context, const TopDUContext* top)
+{
+    const IndexedDUContext indexedContext(const_cast<DUContext*>(context));
+    const MemberIndexKey key(qMakePair(indexedContext.topContextIndex(), indexedContext.localIndex()), top->ownIndex());
+    QMutexLocker lock(&memberIndexesLock);
+    auto it = memberIndexes.find(key);
+    if ( it == memberIndexes.end() || ! isUpToDate(*it) ) {
+        if ( memberIndexes.size() >= maxMemberIndexEntries ) {
+            memberIndexes.clear();
+        }
+        it = memberIndexes.insert(key, buildMemberIndex(context, top));
+    }
+
+    QList<DeclarationDepthPair> result;
+    foreach ( const IndexedMember& member, it->members ) {
+        if ( Declaration* declaration = member.declaration.data() ) {
+            result.append(DeclarationDepthPair(declaration, member.depth));
+        }
+    }
+    return result;
+}
+
 // This is stolen from PHP. For credits, see helpers.cpp in PHP.
 void createArgumentList(Declaration* dec_, QString& ret, QList< QVariant >* highlighting, int atArg, bool includeTypes)
 {
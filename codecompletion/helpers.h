@@ -22,9 +22,12 @@
 #define PYCOMPLETIONHELPERS_H
 
 #include <language/duchain/declaration.h>
+#include <language/duchain/ducontext.h>
+#include <language/duchain/indexedstring.h>
 
 #include <QString>
 #include <QList>
+#include <QVector>
 #include <QVariant>
 
 #include "pythoncompletionexport.h"
@@ -40,6 +43,33 @@ void createArgumentList(Declaration* dec, QString& ret, QList<QVariant>* highlig
 KDEVPYTHONCOMPLETION_EXPORT int identifierMatchQuality(const QString& identifier1_, const QString& identifier2_);
 KDEVPYTHONCOMPLETION_EXPORT QString camelCaseToUnderscore(const QString& camelCase);
 
+/**
+ * @brief The normalized form and word parts of an identifier, as compared by identifierMatchQuality().
+ *
+ * Computing them is the expensive part of the comparison; signatures of declaration names
+ * are cached per thread, so ranking many items against one name only compares a few hashes per item.
+ **/
+class KDEVPYTHONCOMPLETION_EXPORT IdentifierSignature {
+public:
+    IdentifierSignature(const QString& identifier = QString());
+
+    /**
+     * @brief Get the signature of @p identifier, computing it only the first time.
+     **/
+    static IdentifierSignature forIdentifier(const IndexedString& identifier);
+
+    /**
+     * @brief Returns the same value as identifierMatchQuality() for the two identifiers.
+     **/
+    int matchQuality(const IdentifierSignature& other) const;
+
+private:
+    QString m_normalized;
+    int m_partCount;
+    /// the parts with at least three characters and their hashes, sorted by hash
+    QVector<QPair<uint, QString>> m_parts;
+};
+
 class TokenList;
 
 class KDEVPYTHONCOMPLETION_EXPORT ExpressionParser {
@@ -151,6 +181,52 @@ private:
     int m_internalPtr;
 };
 
+/**
+ * @brief Keeps the strings and indents found in the text of the last completion request per document.
+ *
+ * Consecutive requests in one document share most of their text, so only the part after
+ * the first changed character is scanned again.
+ **/
+class KDEVPYTHONCOMPLETION_EXPORT CompletionTextCache {
+public:
+    struct Information {
+        /// the text with all strings replaced, see CodeHelpers::killStrings()
+        QString textWithoutStrings;
+        /// the indent of each line of the text, see FileIndentInformation
+        QList<int> indents;
+    };
+
+    /**
+     * @brief Get the information for @p text, which was requested for completion in @p document.
+     **/
+    static Information information(const IndexedString& document, const QString& text);
+};
+
+/**
+ * @brief Check whether @p name contains all of @p characters in the same order, ignoring case.
+ *
+ * This keeps every name which the completion widget could show for the typed @p characters.
+ **/
+KDEVPYTHONCOMPLETION_EXPORT bool containsCharactersInOrder(const QString& name, const QString& characters);
+
+/**
+ * @brief Caches which declarations of a class or module context are offered for member completion.
+ *
+ * Walking allDeclarations() of a big module (like the PyQt documentation files) takes long, and
+ * the result only changes when one of the documents the declarations come from is parsed again.
+ * Each entry remembers the revisions of those documents, and is rebuilt when one of them changed.
+ **/
+class KDEVPYTHONCOMPLETION_EXPORT MemberNameIndex {
+public:
+    /**
+     * @brief Get the declarations of @p context, as seen from @p top.
+     *
+     * Declarations of the documentation file and magic ones ("__foo__") are left out.
+     * The DUChain must be read-locked.
+     **/
+    static QList<DeclarationDepthPair> members(const DUContext* context, const TopDUContext* top);
+};
+
 class ReplacementVariable;
 
 struct RangeInString {
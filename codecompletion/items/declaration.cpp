@@ -38,6 +38,8 @@ PythonDeclarationCompletionItem::PythonDeclarationCompletionItem(DeclarationPoin
                                : NormalDeclarationCompletionItem(decl, context, inheritanceDepth)
                                , m_typeHint(PythonCodeCompletionContext::NoHint)
                                , m_addMatchQuality(0)
+                               , m_matchAgainst(0)
+                               , m_nameMatchQuality(-1)
 {
     Q_ASSERT(decl->alwaysForceDirect());
     if ( context ) {
@@ -50,12 +52,69 @@ void PythonDeclarationCompletionItem::addMatchQuality(int add)
     m_addMatchQuality += add;
 }
 
+void PythonDeclarationCompletionItem::setMatchAgainst(const IdentifierSignature* matchAgainst)
+{
+    m_matchAgainst = matchAgainst;
+    m_nameMatchQuality = -1;
+}
+
+PythonDeclarationCompletionItem* PythonDeclarationCompletionItem::copyFor(KSharedPtr<CodeCompletionContext> context,
+                                                                          const IdentifierSignature* matchAgainst) const
+{
+    PythonDeclarationCompletionItem* item = new PythonDeclarationCompletionItem(*this);
+    item->rebind(context, matchAgainst);
+    return item;
+}
+
+void PythonDeclarationCompletionItem::rebind(KSharedPtr<CodeCompletionContext> context,
+                                             const IdentifierSignature* matchAgainst)
+{
+    setParent(0);
+    m_completionContext = context;
+    setMatchAgainst(matchAgainst);
+    m_displayCache.clear();
+    m_displayCached.clear();
+}
+
+int PythonDeclarationCompletionItem::addedMatchQuality() const
+{
+    if ( m_nameMatchQuality == -1 ) {
+        m_nameMatchQuality = 0;
+        if ( m_matchAgainst && declaration() ) {
+            Declaration* checkDeclaration = Helper::resolveAliasDeclaration(declaration().data());
+            if ( checkDeclaration ) {
+                m_nameMatchQuality = m_matchAgainst->matchQuality(
+                    IdentifierSignature::forIdentifier(checkDeclaration->identifier().identifier())
+                );
+            }
+        }
+    }
+    return m_addMatchQuality + m_nameMatchQuality;
+}
+
 void PythonDeclarationCompletionItem::setTypeHint(PythonCodeCompletionContext::ItemTypeHint type)
 {
     m_typeHint = type;
 }
 
 QVariant PythonDeclarationCompletionItem::data(const QModelIndex& index, int role, const KDevelop::CodeCompletionModel* model) const
+{
+    const int column = index.column();
+    if ( role != Qt::DisplayRole || column < 0 || column >= KDevelop::CodeCompletionModel::ColumnCount ) {
+        return itemData(index, role, model);
+    }
+    if ( m_displayCache.isEmpty() ) {
+        m_displayCache.resize(KDevelop::CodeCompletionModel::ColumnCount);
+        m_displayCached.resize(KDevelop::CodeCompletionModel::ColumnCount);
+    }
+    if ( ! m_displayCached.testBit(column) ) {
+        m_displayCache[column] = itemData(index, role, model);
+        m_displayCached.setBit(column);
+    }
+    return m_displayCache.at(column);
+}
+
+QVariant PythonDeclarationCompletionItem::itemData(const QModelIndex& index, int role, const KDevelop::CodeCompletionModel* model) const
 {
     switch ( role ) {
         case KDevelop::CodeCompletionModel::MatchQuality: {
@@ -73,12 +132,12 @@ QVariant PythonDeclarationCompletionItem::data(const QModelIndex& index, int rol
                 return 10;
             }
             if ( model->completionContext()->duContext() == declaration()->context() ) {
-                return 5 + m_addMatchQuality;
+                return 5 + addedMatchQuality();
             }
             if ( model->completionContext()->duContext()->topContext() == declaration()->context()->topContext() ) {
-                return 3 + m_addMatchQuality;
+                return 3 + addedMatchQuality();
             }
-            return m_addMatchQuality;
+            return addedMatchQuality();
         }
         case KDevelop::CodeCompletionModel::BestMatchesCount: {
             return 5;
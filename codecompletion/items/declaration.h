@@ -24,6 +24,9 @@
 #include <language/codecompletion/codecompletionmodel.h>
 #include "codecompletion/context.h"
 
+#include <QBitArray>
+#include <QVector>
+
 namespace Python {
 
 class PythonDeclarationCompletionItem : public KDevelop::NormalDeclarationCompletionItem {
@@ -31,12 +34,47 @@ public:
     PythonDeclarationCompletionItem(KDevelop::DeclarationPointer decl = KDevelop::DeclarationPointer(), 
                                     KSharedPtr<KDevelop::CodeCompletionContext> context = KSharedPtr<KDevelop::CodeCompletionContext>(), 
                                     int inheritanceDepth = 0);
+    /**
+     * @brief Returns itemData(), but computes the displayed texts only once.
+     *
+     * The view only asks for the texts of the rows it shows, so in long lists
+     * most items never compute them at all.
+     **/
     virtual QVariant data(const QModelIndex& index, int role, const KDevelop::CodeCompletionModel* model) const;
     void setTypeHint(PythonCodeCompletionContext::ItemTypeHint type);
     void addMatchQuality(int add);
+    /**
+     * @brief Rank this item by how well its name matches @p matchAgainst, see identifierMatchQuality().
+     * The signature must live as long as the item's completion context; it's only compared when needed.
+     **/
+    void setMatchAgainst(const IdentifierSignature* matchAgainst);
+    /// Whether a signature was set with setMatchAgainst().
+    bool hasMatchAgainst() const {
+        return m_matchAgainst;
+    }
+    /**
+     * @brief A copy of this item which belongs to @p context, to show it again for a later completion request.
+     * The copy is ranked by @p matchAgainst instead of the signature of this item; both can be null.
+     **/
+    virtual PythonDeclarationCompletionItem* copyFor(KSharedPtr<KDevelop::CodeCompletionContext> context,
+                                                     const IdentifierSignature* matchAgainst) const;
 protected:
+    /**
+     * @brief Make this copy of an item belong to @p context; see copyFor().
+     **/
+    void rebind(KSharedPtr<KDevelop::CodeCompletionContext> context, const IdentifierSignature* matchAgainst);
+    /**
+     * @brief The actual implementation of data(); subclasses reimplement this.
+     **/
+    virtual QVariant itemData(const QModelIndex& index, int role, const KDevelop::CodeCompletionModel* model) const;
+    int addedMatchQuality() const;
     PythonCodeCompletionContext::ItemTypeHint m_typeHint;
     int m_addMatchQuality;
+private:
+    const IdentifierSignature* m_matchAgainst;
+    mutable int m_nameMatchQuality;
+    mutable QVector<QVariant> m_displayCache;
+    mutable QBitArray m_displayCached;
 };
 
 } // namespace Python
@@ -49,6 +49,14 @@ FunctionDeclarationCompletionItem::FunctionDeclarationCompletionItem(Declaration
 
 }
 
+FunctionDeclarationCompletionItem* FunctionDeclarationCompletionItem::copyFor(CodeCompletionContext::Ptr context,
+                                                                              const IdentifierSignature* matchAgainst) const
+{
+    FunctionDeclarationCompletionItem* item = new FunctionDeclarationCompletionItem(*this);
+    item->rebind(context, matchAgainst);
+    return item;
+}
+
 int FunctionDeclarationCompletionItem::atArgument() const
 {
     return m_atArgument;
@@ -69,7 +77,7 @@ int FunctionDeclarationCompletionItem::argumentHintDepth() const
     return m_depth;
 }
 
-QVariant FunctionDeclarationCompletionItem::data(const QModelIndex& index, int role, const KDevelop::CodeCompletionModel* model) const
+QVariant FunctionDeclarationCompletionItem::itemData(const QModelIndex& index, int role, const KDevelop::CodeCompletionModel* model) const
 {
     DUChainReadLocker lock;
     FunctionDeclaration* dec = dynamic_cast<FunctionDeclaration*>(m_declaration.data());
@@ -117,12 +125,12 @@ QVariant FunctionDeclarationCompletionItem::data(const QModelIndex& index, int r
                  && dec && dec->type<FunctionType>()
                  && dynamic_cast<ListType*>(dec->type<FunctionType>()->returnType().unsafeData()) )
             {
-                return 2 + PythonDeclarationCompletionItem::data(index, role, model).toInt();
+                return 2 + PythonDeclarationCompletionItem::itemData(index, role, model).toInt();
             }
-            return PythonDeclarationCompletionItem::data(index, role, model);
+            return PythonDeclarationCompletionItem::itemData(index, role, model);
         }
     }
-    return Python::PythonDeclarationCompletionItem::data(index, role, model);
+    return Python::PythonDeclarationCompletionItem::itemData(index, role, model);
 }
 
 void FunctionDeclarationCompletionItem::setDoNotCall(bool doNotCall)
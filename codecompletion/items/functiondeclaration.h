@@ -38,10 +38,12 @@ public:
     void setAtArgument(int d);
     void setDepth(int d);
     void setDoNotCall(bool doNotCall);
-    
-    virtual QVariant data(const QModelIndex& index, int role, const CodeCompletionModel* model) const;
+    virtual FunctionDeclarationCompletionItem* copyFor(KDevelop::CodeCompletionContext::Ptr context,
+                                                       const IdentifierSignature* matchAgainst) const;
     
     virtual void executed(KTextEditor::Document* document, const KTextEditor::Range& word);
+protected:
+    virtual QVariant itemData(const QModelIndex& index, int role, const CodeCompletionModel* model) const;
 private:
     int m_atArgument;
     int m_depth;
@@ -37,6 +37,14 @@ KeywordItem::KeywordItem(KDevelop::CodeCompletionContext::Ptr context, QString k
     m_keyword = keyword;
 }
 
+KeywordItem* KeywordItem::copyFor(CodeCompletionContext::Ptr context) const
+{
+    KeywordItem* item = new KeywordItem(*this);
+    item->setParent(0);
+    item->m_completionContext = context;
+    return item;
+}
+
 void KeywordItem::execute(Document* document, const Range& word)
 {
     if ( m_flags & ForceLineBeginning ) {
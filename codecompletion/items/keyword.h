@@ -35,6 +35,10 @@ public:
         ImportantItem = 0x2
     };
     KeywordItem(CodeCompletionContext::Ptr context, QString keyword, QString descr, Python::KeywordItem::Flags flags = NoFlags);
+    /**
+     * @brief A copy of this item which belongs to @p context, to show it again for a later completion request.
+     **/
+    KeywordItem* copyFor(CodeCompletionContext::Ptr context) const;
     virtual void execute(KTextEditor::Document* document, const KTextEditor::Range& word);
     virtual QVariant data(const QModelIndex& index, int role, const KDevelop::CodeCompletionModel* model) const;
 private:
@@ -20,9 +20,14 @@
 
 #include <KTextEditor/View>
 #include <KTextEditor/Document>
+#include <language/duchain/indexedstring.h>
+
+#include <QTimer>
 
 #include "context.h"
 #include "worker.h"
+#include "helpers.h"
+#include "codehelpers.h"
 
 namespace Python {
 
@@ -31,6 +36,11 @@ PythonCodeCompletionModel::PythonCodeCompletionModel(QObject* parent)
 {
     // This avoids flickering of the completion-list when full code-completion mode is used
     setForceWaitForModel(true);
+
+    m_speculationTimer = new QTimer(this);
+    m_speculationTimer->setSingleShot(true);
+    m_speculationTimer->setInterval(300);
+    connect(m_speculationTimer, SIGNAL(timeout()), this, SLOT(speculateAfterIdentifier()));
 }
 
 PythonCodeCompletionModel::~PythonCodeCompletionModel() { }
@@ -38,6 +48,22 @@ PythonCodeCompletionModel::~PythonCodeCompletionModel() { }
 bool PythonCodeCompletionModel::shouldStartCompletion(KTextEditor::View* view, const QString& inserted,
                                                 bool userInsertion, const KTextEditor::Cursor& position)
 {
+    if ( userInsertion && ! inserted.isEmpty() ) {
+        // any edit makes the pending speculation useless
+        if ( PythonCodeCompletionWorker* pythonWorker = static_cast<PythonCodeCompletionWorker*>(worker()) ) {
+            pythonWorker->cancelSpeculation();
+        }
+        m_speculationTimer->stop();
+        const QChar last = inserted.at(inserted.size() - 1);
+        if ( last == '.' ) {
+            speculateMemberAccess(view, position, true);
+        }
+        else if ( last.isLetterOrNumber() || last == '_' ) {
+            m_speculationView = view;
+            m_speculationTimer->start();
+        }
+    }
+
     QList<QString> words;
     words << "for" << "raise" << "except" << "in";
     foreach ( const QString& word, words ) {
@@ -61,6 +87,68 @@ bool PythonCodeCompletionModel::shouldStartCompletion(KTextEditor::View* view, c
     return KDevelop::CodeCompletionModel::shouldStartCompletion(view, inserted, userInsertion, position);
 }
 
+void PythonCodeCompletionModel::speculateAfterIdentifier()
+{
+    if ( m_speculationView ) {
+        speculateMemberAccess(m_speculationView, m_speculationView->cursorPosition(), false);
+    }
+}
+
+void PythonCodeCompletionModel::speculateMemberAccess(KTextEditor::View* view, const KTextEditor::Cursor& position,
+                                                      bool dotTyped)
+{
+    PythonCodeCompletionWorker* pythonWorker = static_cast<PythonCodeCompletionWorker*>(worker());
+    if ( ! pythonWorker ) {
+        return;
+    }
+    // Only the current line is looked at; this is a guess, and must be cheap to make.
+    QString text = view->document()->line(position.line()).left(position.column());
+    if ( CodeHelpers::endsInside(text) != CodeHelpers::Code ) {
+        return;
+    }
+    if ( ! dotTyped ) {
+        text.append('.');
+    }
+    ExpressionParser parser(CodeHelpers::killStrings(text));
+    TokenList expressions = parser.popAll();
+    // the completion context offers something else than member access for these
+    if (    expressions.length() < 2
+         || expressions.last().status != ExpressionParser::MemberAccessFound
+         || expressions.at(expressions.length() - 2).status != ExpressionParser::ExpressionFound
+         || expressions.nextIndexOfStatus(ExpressionParser::ImportFound).first != -1
+         || expressions.nextIndexOfStatus(ExpressionParser::FromFound).first != -1
+         || expressions.nextIndexOfStatus(ExpressionParser::DefFound).first != -1
+         || expressions.nextIndexOfStatus(ExpressionParser::ClassFound).first != -1 )
+    {
+        return;
+    }
+    // Like the completion context, fetch only the lines the expression spans; it ends before the dot.
+    TextDocumentLazyLineFetcher lineFetcher(view->document());
+    const int expressionEnd = position.column() - ( dotTyped ? 2 : 1 );
+    const QString expression = CodeHelpers::expressionUnderCursor(lineFetcher,
+                                                                  KTextEditor::Cursor(position.line(), expressionEnd), true);
+    if ( expression.isEmpty() ) {
+        return;
+    }
+    // The context is looked up by the speculation, so the DUChain is not locked in the main thread.
+    // It compares the indents of the lines above the cursor with the cursor's line, going up
+    // through the parents of the context; none of them starts below a line without indent.
+    QList<int> indents;
+    for ( int line = position.line(); line >= 0; line-- ) {
+        const QString text = view->document()->line(line);
+        int indent = 0;
+        while ( indent < text.size() && text.at(indent).isSpace() ) {
+            indent++;
+        }
+        indents.prepend(indent);
+        if ( indent == 0 && ! text.isEmpty() && line != position.line() ) {
+            break;
+        }
+    }
+    pythonWorker->speculateMemberAccess(KDevelop::IndexedString(view->document()->url()), indents,
+                                        KDevelop::CursorInRevision(position.line(), position.column()), expression);
+}
+
 bool PythonCodeCompletionModel::shouldAbortCompletion(KTextEditor::View* view, const KTextEditor::Range& range, const QString& currentCompletion)
 {
     const QString text = view->document()->text(range);
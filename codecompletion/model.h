@@ -23,13 +23,16 @@
 #include <language/codecompletion/codecompletionmodel.h>
 #include <language/duchain/duchainpointer.h>
 #include <KUrl>
+#include <QPointer>
+
+class QTimer;
 
 
 namespace Python {
 
 class KDEVPYTHONCOMPLETION_EXPORT PythonCodeCompletionModel : public KDevelop::CodeCompletionModel
 {
-
+Q_OBJECT
 public:
     PythonCodeCompletionModel(QObject* parent);
     virtual ~PythonCodeCompletionModel();
@@ -42,6 +45,21 @@ public:
     QString filterString(KTextEditor::View *view, const KTextEditor::Range &range, const KTextEditor::Cursor &position);
 
     KUrl m_currentDocument;
+
+private slots:
+    /// The user stopped typing after an identifier, a dot might follow.
+    void speculateAfterIdentifier();
+
+private:
+    /**
+     * @brief Let the worker evaluate the expression before @p position if a member access on it is likely,
+     * so the items are ready sooner when the completion popup opens.
+     * @param dotTyped whether the text before @p position ends with the dot already
+     **/
+    void speculateMemberAccess(KTextEditor::View* view, const KTextEditor::Cursor& position, bool dotTyped);
+
+    QTimer* m_speculationTimer;
+    QPointer<KTextEditor::View> m_speculationView;
 };
 
 }
@@ -22,6 +22,7 @@
 #include <language/duchain/declaration.h>
 #include <language/codegen/coderepresentation.h>
 #include <language/duchain/duchain.h>
+#include <language/duchain/types/structuretype.h>
 #include <interfaces/ilanguagecontroller.h>
 
 #include <tests/testcore.h>
@@ -35,6 +36,7 @@
 
 #include "codecompletion/context.h"
 #include "codecompletion/helpers.h"
+#include "parser/codehelpers.h"
 
 using namespace KDevelop;
 
@@ -111,6 +113,12 @@ void PyCompletionTest::initShell()
     makefile("submoduledir/anothersubdir/__init__.py", "var_in_subsub_init = 5");
     makefile("submoduledir/anothersubdir/subsubfile.py", "var_in_subsubfile = 5\nclass another_subfile_class():"
                                                       "\n def method3(): pass");
+    // a module with lots of names, like the ones which are usually star-imported
+    QString manyNames;
+    for ( int i = 0; i < 3000; i++ ) {
+        manyNames += QString("name_%1 = %1\nclass Class_%1():\n member_%1 = %1\n").arg(i);
+    }
+    makefile("manynames.py", manyNames);
 }
 
 void PyCompletionTest::testIdentifierMatching()
@@ -128,6 +136,15 @@ void PyCompletionTest::testIdentifierMatching()
     QCOMPARE(identifierMatchQuality("xydsf", "qkigfb"), 0);
     QCOMPARE(identifierMatchQuality("ac_ac", "ac_ae"), 0);
     QCOMPARE(identifierMatchQuality("AcAb", "AbDe"), 0);
+    QCOMPARE(identifierMatchQuality("one_two_three_four_five_six", "six"), 2);
+    QCOMPARE(identifierMatchQuality("one_two_three_four_five_six", "six_seven"), 0);
+
+    // cached signatures give the same result as computing them on the spot
+    IdentifierSignature target("FoobarBang");
+    QCOMPARE(target.matchQuality(IdentifierSignature::forIdentifier(IndexedString("foobar_baz"))), 1);
+    QCOMPARE(target.matchQuality(IdentifierSignature::forIdentifier(IndexedString("foobar_baz"))), 1);
+    QCOMPARE(target.matchQuality(IdentifierSignature::forIdentifier(IndexedString("bang"))), 2);
+    QCOMPARE(target.matchQuality(IdentifierSignature::forIdentifier(IndexedString("xydsf"))), 0);
 }
 
 void PyCompletionTest::testExpressionParserMisc()
@@ -481,6 +498,14 @@ void PyCompletionTest::testExceptionCompletion()
     items = invokeCompletionOn("localvar = 3\n%INVOKE", "try: pass\nexcept %CURSOR");
     QVERIFY(containsItemForDeclarationNamed(items, "Exception"));
     QVERIFY(! containsItemForDeclarationNamed(items, "localvar"));
+
+    // indirect subclasses of BaseException are offered as well
+    items = invokeCompletionOn("class MyError(ValueError): pass\nclass MyOtherError(MyError): pass\n"
+                               "class NoError(): pass\nraise %INVOKE", "%CURSOR");
+    QVERIFY(containsItemForDeclarationNamed(items, "ValueError"));
+    QVERIFY(containsItemForDeclarationNamed(items, "MyError"));
+    QVERIFY(containsItemForDeclarationNamed(items, "MyOtherError"));
+    QVERIFY(! containsItemForDeclarationNamed(items, "NoError"));
 }
 
 void PyCompletionTest::testGeneratorCompletion()
@@ -658,6 +683,209 @@ QString repeat_distinct(const QString& code, int count) {
     return result;
 }
 
+void PyCompletionTest::testIncrementalCompletion()
+{
+    PythonCodeCompletionModel model(0);
+    PythonCodeCompletionWorker worker(&model, KUrl());
+    CompletionParameters data = prepareCompletion("class my():\n foo = 1\n fob = 2\n bar = 3\nd = my()\n%INVOKE",
+                                                  "d.f%CURSOR");
+    QList<CompletionTreeItemPointer> all;
+    bool rebound = true;
+    auto complete = [&data, &worker, &all, &rebound](const QString& snip) {
+        KSharedPtr<PythonCodeCompletionContext> context(new PythonCodeCompletionContext(
+            data.contextAtCursor, snip, data.remaining, data.cursorAt, 0, &worker
+        ));
+        bool abort = false;
+        QList<CompletionTreeItemPointer> result = context->completionItems(abort, true);
+        QList<CompletionTreeItem*> items;
+        foreach ( const CompletionTreeItemPointer& item, result ) {
+            // items taken from the previous request belong to the new context
+            auto declarationItem = KSharedPtr<NormalDeclarationCompletionItem>::dynamicCast(item);
+            if ( declarationItem && declarationItem->completionContext().data() != context.data() ) {
+                rebound = false;
+            }
+            items << item.data();
+        }
+        all << result;
+        return items;
+    };
+
+    QList<CompletionTreeItem*> first = complete(data.snip);
+    QVERIFY(containsItemForDeclarationNamed(first, "foo"));
+    QVERIFY(! containsItemForDeclarationNamed(first, "bar"));
+
+    QList<CompletionTreeItem*> extended = complete(data.snip + "o");
+    QVERIFY(containsItemForDeclarationNamed(extended, "foo"));
+    QVERIFY(containsItemForDeclarationNamed(extended, "fob"));
+    QVERIFY(! containsItemForDeclarationNamed(extended, "bar"));
+
+    // removing the typed text brings back the items which were dropped
+    QList<CompletionTreeItem*> shortened = complete(data.snip.left(data.snip.size() - 1));
+    QVERIFY(containsItemForDeclarationNamed(shortened, "foo"));
+    QVERIFY(containsItemForDeclarationNamed(shortened, "bar"));
+
+    // a different expression before the identifier needs a new result
+    QList<CompletionTreeItem*> other = complete(data.snip.left(data.snip.size() - 3) + "my.f");
+    QVERIFY(containsItemForDeclarationNamed(other, "foo"));
+    QVERIFY(rebound);
+    m_ptrs << all;
+}
+
+void PyCompletionTest::testCompletionTextCache()
+{
+    const IndexedString document("/tmp/textcache.py");
+    // each text is an edit of the previous one, as it happens while typing
+    QStringList texts;
+    texts << "class A:\n    def f(self):\n        return 'a' + \"b\"\n    x = "
+          << "class A:\n    def f(self):\n        return 'a' + \"b\"\n    x = 'c"
+          << "class A:\n    def f(self):\n        return 'a' + \"b\"\n    x = 'c'.up"
+          << "class A:\n    def f(self):\n        return \"a' + \"b\"\n    x = 'c'.up"
+          << "class A:\n  def f(self):\n        return \"a' + \"b\"\n    x = 'c'.up\n\n"
+          << "class A:\n  def f(self):\n"
+          << "";
+    foreach ( const QString& text, texts ) {
+        const CompletionTextCache::Information information = CompletionTextCache::information(document, text);
+        QCOMPARE(information.textWithoutStrings, CodeHelpers::killStrings(text));
+        FileIndentInformation expected(text);
+        QCOMPARE(information.indents.size(), expected.linesCount());
+        for ( int line = 0; line < expected.linesCount(); line++ ) {
+            QCOMPARE(information.indents.at(line), expected.indentForLine(line));
+        }
+    }
+}
+
+void PyCompletionTest::testMemberNameIndex()
+{
+    QVERIFY(containsCharactersInOrder("alphabet", "alp"));
+    QVERIFY(containsCharactersInOrder("QAbstractButton", "qab"));
+    QVERIFY(containsCharactersInOrder("QAbstractButton", ""));
+    QVERIFY(! containsCharactersInOrder("alphabet", "pla"));
+    QVERIFY(! containsCharactersInOrder("beta", "betas"));
+
+    const QString code = "class my():\n alpha = 1\n beta = 2\n alphabet = 3\n __alpha__ = 4\nd = my()\n%INVOKE";
+    // the typed text is not used to leave out members, they are shown again when it is removed
+    QList<CompletionTreeItem*> items = invokeCompletionOn(code, "d.alp%CURSOR");
+    QVERIFY(containsItemForDeclarationNamed(items, "alpha"));
+    QVERIFY(containsItemForDeclarationNamed(items, "alphabet"));
+    QVERIFY(containsItemForDeclarationNamed(items, "beta"));
+    QVERIFY(! containsItemForDeclarationNamed(items, "__alpha__"));
+
+    items = invokeCompletionOn(code, "d.%CURSOR");
+    QVERIFY(containsItemForDeclarationNamed(items, "alpha"));
+    QVERIFY(containsItemForDeclarationNamed(items, "beta"));
+
+    CompletionParameters data = prepareCompletion(code, "%CURSOR");
+    {
+        DUChainReadLocker lock;
+        QList<Declaration*> classes = data.contextAtCursor->topContext()->findDeclarations(QualifiedIdentifier("my"));
+        QVERIFY(! classes.isEmpty() && classes.first()->internalContext());
+        const DUContext* internal = classes.first()->internalContext();
+        const TopDUContext* top = data.contextAtCursor->topContext();
+        QCOMPARE(MemberNameIndex::members(internal, top).size(), 3);
+        // the second lookup is answered from the cache
+        QCOMPARE(MemberNameIndex::members(internal, top).size(), 3);
+    }
+
+    QVERIFY(declarationInCompletionList("import manynames\n%INVOKE", "manynames.Class_12%CURSOR", "Class_123"));
+    QVERIFY(declarationInCompletionList("import manynames\n%INVOKE", "manynames.Class_12%CURSOR", "name_12"));
+}
+
+void PyCompletionTest::testMemberAccessType()
+{
+    const QString code = "class my():\n alpha = 1\n def beta(self): return 3.5\nd = my()\n%INVOKE";
+    CompletionParameters data = prepareCompletion(code, "%CURSOR");
+
+    AbstractType::Ptr type = PythonCodeCompletionContext::memberAccessType(data.contextAtCursor, "d");
+    QVERIFY(type);
+    PythonCodeCompletionContext::prepareMemberIndex(data.contextAtCursor, type);
+    {
+        DUChainReadLocker lock;
+        QCOMPARE(type->toString(), QString("my"));
+        StructureType::Ptr cls = type.cast<StructureType>();
+        QVERIFY(cls);
+        QList<DeclarationDepthPair> members = MemberNameIndex::members(cls->internalContext(data.contextAtCursor->topContext()),
+                                                                       data.contextAtCursor->topContext());
+        QCOMPARE(members.size(), 2);
+    }
+
+    type = PythonCodeCompletionContext::memberAccessType(data.contextAtCursor, "d.beta()");
+    QVERIFY(type);
+    {
+        DUChainReadLocker lock;
+        QCOMPARE(type->toString(), QString("float"));
+    }
+    QVERIFY(! PythonCodeCompletionContext::memberAccessType(data.contextAtCursor, "d.(]"));
+
+    // the completion items are the same as without the speculation
+    QList<CompletionTreeItem*> items = invokeCompletionOn(code, "d.%CURSOR");
+    QVERIFY(containsItemForDeclarationNamed(items, "alpha"));
+    QVERIFY(containsItemForDeclarationNamed(items, "beta"));
+}
+
+void PyCompletionTest::testSpeculatedMemberAccess()
+{
+    PythonCodeCompletionModel model(0);
+    PythonCodeCompletionWorker worker(&model, KUrl());
+    // The empty line ends the range of f() before the cursor, but completion still uses the context of f(),
+    // and so must the speculation.
+    CompletionParameters data = prepareCompletion("class my():\n alpha = 1\ndef f():\n d = my()\n\n %INVOKE",
+                                                  "d.%CURSOR");
+    IndexedString document;
+    {
+        DUChainReadLocker lock;
+        document = data.contextAtCursor->topContext()->url();
+    }
+    QList<int> indents;
+    foreach ( const QString& line, data.snip.split('\n') ) {
+        int indent = 0;
+        while ( indent < line.size() && line.at(indent).isSpace() ) {
+            indent++;
+        }
+        indents << indent;
+    }
+    worker.speculateMemberAccess(document, indents, data.cursorAt, "d");
+
+    KSharedPtr<PythonCodeCompletionContext> context(new PythonCodeCompletionContext(
+        data.contextAtCursor, data.snip, data.remaining, data.cursorAt, 0, &worker
+    ));
+    const DUContextPointer completionContext(context->duContext());
+    AbstractType::Ptr type;
+    for ( int i = 0; i < 500 && ! worker.speculatedType(completionContext, "d", &type); i++ ) {
+        QTest::qWait(10);
+    }
+    QVERIFY(type);
+    {
+        DUChainReadLocker lock;
+        QCOMPARE(type->toString(), QString("my"));
+    }
+    QVERIFY(! worker.speculatedType(completionContext, "e", &type));
+
+    bool abort = false;
+    QList<CompletionTreeItem*> items;
+    foreach ( const CompletionTreeItemPointer& item, context->completionItems(abort, true) ) {
+        items << item.data();
+        m_ptrs << item;
+    }
+    QVERIFY(containsItemForDeclarationNamed(items, "alpha"));
+}
+
+void PyCompletionTest::identifierMatchingBenchTest()
+{
+    // ranks many declaration names against the target of an assignment, as in "some_value = "
+    QList<IndexedString> names;
+    for ( int i = 0; i < 3000; i++ ) {
+        names << IndexedString(QString("someLongName%1_value_%2").arg(i % 50).arg(i));
+    }
+    int total = 0;
+    QBENCHMARK {
+        const IdentifierSignature target("some_value");
+        foreach ( const IndexedString& name, names ) {
+            total += target.matchQuality(IdentifierSignature::forIdentifier(name));
+        }
+    }
+    QVERIFY(total > 0);
+}
+
 void PyCompletionTest::completionBenchTest()
 {
     QFETCH(QString, completionCode);
@@ -679,11 +907,21 @@ void PyCompletionTest::completionBenchTest_data()
     QTest::newRow("function") << "%INVOKE" << "foo(%CURSOR";
     QTest::newRow("deep_function") << "foo(bar(baz(bang([]%INVOKE))))" << ".%CURSOR";
     QTest::newRow("class_completion") << "class my(): pass\nd = my()\n%INVOKE" << "d.%CURSOR";
+    QTest::newRow("member_access_chain") << "class A:\n def __init__(self): self.b = B()\n"
+                                            "class B:\n def c(self): return [A()]\n"
+                                            "a = A()\n%INVOKE" << "a.b.c()[0].b.%CURSOR";
 
     QString many_globals = repeat_distinct("a%X=%X\n", 1000);
 
     QTest::newRow("function_many_globals") << many_globals + "%INVOKE" << "foo(%CURSOR";
     QTest::newRow("variable_completion_many_globals") << many_globals + "%INVOKE" << "b = a%CURSOR";
+    QTest::newRow("star_import") << "from manynames import *\n%INVOKE" << "b = na%CURSOR";
+    QTest::newRow("star_import_in_method") << "from manynames import *\n"
+                                              "class C(Class_1):\n"
+                                              + repeat_distinct(" attribute_%X = %X\n", 500) +
+                                              " def f(self):\n  %INVOKE" << "b = na%CURSOR";
+    QTest::newRow("module_members") << "import manynames\n%INVOKE" << "manynames.%CURSOR";
+    QTest::newRow("module_members_typed") << "import manynames\n%INVOKE" << "manynames.Class_12%CURSOR";
 }
 
 }
@@ -88,9 +88,15 @@ class PyCompletionTest : public QObject
         void testStringFormattingCompletion_data();
         void testStringFormatter();
         void testStringFormatter_data();
+        void testIncrementalCompletion();
+        void testCompletionTextCache();
+        void testMemberNameIndex();
+        void testMemberAccessType();
+        void testSpeculatedMemberAccess();
         // benchmarks
         void completionBenchTest();
         void completionBenchTest_data();
+        void identifierMatchingBenchTest();
     private:
         QList<CompletionTreeItemPointer> m_ptrs;
 
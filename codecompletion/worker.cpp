@@ -20,6 +20,10 @@
 #include "model.h"
 #include "context.h"
 #include <language/duchain/declaration.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/topducontext.h>
+#include <language/duchain/parsingenvironment.h>
+#include <language/duchain/duchainutils.h>
 #include <KLocalizedString>
 #include "codehelpers.h"
 #include <KTextEditor/View>
@@ -29,7 +33,13 @@ namespace Python {
 PythonCodeCompletionWorker::PythonCodeCompletionWorker(PythonCodeCompletionModel *parent, KUrl /*document*/)
     : KDevelop::CodeCompletionWorker(parent), parent(parent)
 {
+    m_speculationPool.setMaxThreadCount(1);
+}
 
+PythonCodeCompletionWorker::~PythonCodeCompletionWorker()
+{
+    cancelSpeculation();
+    m_speculationPool.waitForDone();
 }
 
 
@@ -45,6 +55,159 @@ KDevelop::CodeCompletionContext* PythonCodeCompletionWorker::createCompletionCon
     return completionContext;
 }
 
+bool PythonCodeCompletionWorker::cachedCompletion(const CompletionRequest& request,
+                                                  QList<CachedCompletionItem>* items,
+                                                  QList<CachedCompletionGroup>* groups) const
+{
+    QMutexLocker lock(&m_lastCompletionLock);
+    if ( ! m_hasLastCompletion || ! ( request == m_lastRequest ) ) {
+        return false;
+    }
+    *items = m_lastItems;
+    *groups = m_lastGroups;
+    return true;
+}
+
+void PythonCodeCompletionWorker::storeCompletion(const CompletionRequest& request,
+                                                 const QList<CachedCompletionItem>& items,
+                                                 const QList<CachedCompletionGroup>& groups) const
+{
+    QMutexLocker lock(&m_lastCompletionLock);
+    m_lastRequest = request;
+    m_hasLastCompletion = true;
+    m_lastItems = items;
+    m_lastGroups = groups;
+}
+
+namespace {
+    KDevelop::ModificationRevision revisionOf(const KDevelop::DUContext* context)
+    {
+        if ( KDevelop::ParsingEnvironmentFilePointer file = context->topContext()->parsingEnvironmentFile() ) {
+            return file->modificationRevision();
+        }
+        return KDevelop::ModificationRevision();
+    }
+}
+
+class PythonCodeCompletionWorker::SpeculationJob : public QRunnable
+{
+public:
+    SpeculationJob(PythonCodeCompletionWorker* worker, const Speculation& speculation, const QList<int>& indents)
+        : m_worker(worker)
+        , m_speculation(speculation)
+        , m_indents(indents)
+    { }
+    virtual void run() {
+        m_worker->runSpeculation(m_speculation, m_indents);
+    }
+private:
+    PythonCodeCompletionWorker* m_worker;
+    Speculation m_speculation;
+    QList<int> m_indents;
+};
+
+void PythonCodeCompletionWorker::speculateMemberAccess(const KDevelop::IndexedString& document,
+                                                       const QList<int>& indents,
+                                                       const KDevelop::CursorInRevision& position,
+                                                       const QString& expression)
+{
+    const KDevelop::ModificationRevision revision = KDevelop::ModificationRevision::revisionForFile(document);
+    {
+        QMutexLocker lock(&m_speculationLock);
+        if ( m_requested.document == document && m_requested.expression == expression
+             && m_requested.revision == revision
+             && m_requested.generation == m_speculationGeneration.loadAcquire() )
+        {
+            return;
+        }
+    }
+    Speculation pending;
+    pending.document = document;
+    pending.position = position;
+    pending.expression = expression;
+    pending.generation = m_speculationGeneration.fetchAndAddOrdered(1) + 1;
+    {
+        QMutexLocker lock(&m_speculationLock);
+        m_requested = pending;
+        m_requested.revision = revision;
+    }
+    // Completion requests are queued for the worker thread, so the speculation gets a thread of
+    // its own; older speculations waiting for it are dropped when they get to run.
+    m_speculationPool.start(new SpeculationJob(this, pending, indents));
+}
+
+void PythonCodeCompletionWorker::cancelSpeculation()
+{
+    m_speculationGeneration.fetchAndAddOrdered(1);
+}
+
+bool PythonCodeCompletionWorker::speculatedType(const KDevelop::DUContextPointer& context, const QString& expression,
+                                                KDevelop::AbstractType::Ptr* type) const
+{
+    Speculation speculated;
+    {
+        QMutexLocker lock(&m_speculationLock);
+        speculated = m_speculated;
+    }
+    if ( ! speculated.type.isValid() || speculated.expression != expression ) {
+        return false;
+    }
+    KDevelop::DUChainReadLocker lock;
+    if ( ! context || ! ( KDevelop::IndexedDUContext(context.data()) == speculated.context )
+         || ! ( revisionOf(context.data()) == speculated.revision ) )
+    {
+        return false;
+    }
+    *type = speculated.type.abstractType();
+    return static_cast<bool>(*type);
+}
+
+void PythonCodeCompletionWorker::runSpeculation(Speculation pending, const QList<int>& indents)
+{
+    // the text was edited since, so the result is probably not needed anymore
+    auto outdated = [this, &pending]() {
+        return pending.generation != m_speculationGeneration.loadAcquire();
+    };
+    if ( outdated() ) {
+        return;
+    }
+    KDevelop::DUContextPointer context;
+    {
+        KDevelop::DUChainReadLocker lock;
+        KDevelop::TopDUContext* top = KDevelop::DUChainUtils::standardContextForUrl(pending.document.toUrl());
+        if ( ! top ) {
+            return;
+        }
+        // the same lookup as for the completion request which follows
+        KDevelop::DUContext* atCursor = top->findContextAt(pending.position);
+        if ( ! atCursor ) {
+            return;
+        }
+        context = KDevelop::DUContextPointer(PythonCodeCompletionContext::contextForCompletion(
+            atCursor, FileIndentInformation(indents), pending.position.line, pending.position
+        ));
+        pending.context = KDevelop::IndexedDUContext(context.data());
+        pending.revision = revisionOf(context.data());
+    }
+    KDevelop::AbstractType::Ptr type;
+    if ( outdated() || speculatedType(context, pending.expression, &type) ) {
+        return;
+    }
+    type = PythonCodeCompletionContext::memberAccessType(context, pending.expression);
+    if ( ! type || outdated() ) {
+        return;
+    }
+    pending.type = type->indexed();
+    {
+        QMutexLocker lock(&m_speculationLock);
+        m_speculated = pending;
+    }
+    if ( outdated() ) {
+        return;
+    }
+    PythonCodeCompletionContext::prepareMemberIndex(context, type);
+}
+
 void PythonCodeCompletionWorker::updateContextRange(KTextEditor::Range &contextRange, KTextEditor::View *view, KDevelop::DUContextPointer context) const
 {
     if ( CodeHelpers::endsInside(view->document()->text(contextRange)) == CodeHelpers::String ) {
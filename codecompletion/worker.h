@@ -22,18 +22,139 @@
 #include "model.h"
 #include <language/codecompletion/codecompletionworker.h>
 #include <language/codecompletion/codecompletionitem.h>
+#include <language/codecompletion/codecompletioncontext.h>
+#include <language/duchain/indexedducontext.h>
+#include <language/duchain/indexedstring.h>
+#include <language/duchain/duchainpointer.h>
+#include <language/editor/modificationrevision.h>
+#include <language/duchain/types/indexedtype.h>
 #include "pythoncompletionexport.h"
 
+#include <QAtomicInt>
+#include <QMutex>
+#include <QThreadPool>
+
 namespace Python {
 
+/**
+ * @brief Everything the completion items of a request depend on, apart from the identifier being typed.
+ **/
+struct CompletionRequest {
+    KDevelop::IndexedDUContext context;
+    KDevelop::ModificationRevision revision;
+    int operation = -1;
+    int line = -1;
+    bool fullCompletion = false;
+    /// the text before the cursor, without the identifier being typed
+    QString baseText;
+    QString followingText;
+
+    bool operator==(const CompletionRequest& other) const {
+        return context == other.context && revision == other.revision && operation == other.operation
+               && line == other.line && fullCompletion == other.fullCompletion
+               && baseText == other.baseText && followingText == other.followingText;
+    };
+};
+
+/**
+ * @brief An item of a cached completion result, detached from the completion context which created it.
+ **/
+struct CachedCompletionItem {
+    KDevelop::CompletionTreeItemPointer item;
+    /// how far up the chain of parents the item's completion context was; -1 if it had none
+    int contextDepth = -1;
+    /// whether the item was ranked by the signature of its context, see PythonDeclarationCompletionItem::setMatchAgainst()
+    bool matchesSignature = false;
+};
+
+struct CachedCompletionGroup {
+    QString name;
+    int inheritanceDepth = 0;
+    QList<CachedCompletionItem> items;
+};
+
 class KDEVPYTHONCOMPLETION_EXPORT PythonCodeCompletionWorker : public KDevelop::CodeCompletionWorker
 {
-
 public:
     PythonCodeCompletionWorker(PythonCodeCompletionModel *parent, KUrl document);
+    virtual ~PythonCodeCompletionWorker();
     virtual KDevelop::CodeCompletionContext* createCompletionContext(KDevelop::DUContextPointer context, const QString& contextText, const QString& followingText, const KDevelop::CursorInRevision& position) const;
     virtual void updateContextRange(KTextEditor::Range &contextRange, KTextEditor::View *view, KDevelop::DUContextPointer context) const;
     PythonCodeCompletionModel* parent;
+
+    /**
+     * @brief Get the result of the last request, if @p request only differs from it by the identifier being typed.
+     * @return true if the result could be used; it is then stored in @p items and @p groups.
+     **/
+    bool cachedCompletion(const CompletionRequest& request, QList<CachedCompletionItem>* items,
+                          QList<CachedCompletionGroup>* groups) const;
+
+    /**
+     * @brief Remember the result of a request, replacing the previous one.
+     * The items must not be filtered by the identifier being typed.
+     **/
+    void storeCompletion(const CompletionRequest& request, const QList<CachedCompletionItem>& items,
+                         const QList<CachedCompletionGroup>& groups) const;
+
+    /**
+     * @brief Evaluate the type of @p expression at @p position in @p document, before completion is requested.
+     *
+     * Used when a member access on @p expression is likely to follow. This runs in a thread of its own,
+     * so it does not delay the completion requests of the worker. The context is looked up like
+     * the completion context does it; @p indents are the indents of the lines up to the one of @p position,
+     * or of the last few of them, see FileIndentInformation.
+     * The type is remembered for speculatedType(), and the member index of the type is built.
+     * A newer speculation or cancelSpeculation() stops this one at the next step. Nothing is done
+     * if the last speculation was for the same expression and revision of the document, and is still valid.
+     * Can be called from any thread, the DUChain is not locked by it.
+     **/
+    void speculateMemberAccess(const KDevelop::IndexedString& document, const QList<int>& indents,
+                               const KDevelop::CursorInRevision& position, const QString& expression);
+
+    /**
+     * @brief Drop the pending speculation, e.g. because the text was edited.
+     **/
+    void cancelSpeculation();
+
+    /**
+     * @brief Get the type found by the last speculation, if it was for @p expression in @p context
+     * and the document was not parsed again since.
+     * @return true if the type could be used; it is then stored in @p type.
+     **/
+    bool speculatedType(const KDevelop::DUContextPointer& context, const QString& expression,
+                        KDevelop::AbstractType::Ptr* type) const;
+
+private:
+    class SpeculationJob;
+
+    struct Speculation {
+        KDevelop::IndexedString document;
+        KDevelop::CursorInRevision position;
+        KDevelop::IndexedDUContext context;
+        KDevelop::ModificationRevision revision;
+        QString expression;
+        KDevelop::IndexedType type;
+        int generation = 0;
+    };
+    void runSpeculation(Speculation pending, const QList<int>& indents);
+
+    /// counts speculation requests and cancellations; a speculation stops once it changes
+    QAtomicInt m_speculationGeneration;
+    mutable QMutex m_speculationLock;
+    Speculation m_speculated;
+    /// the last speculation which was started; its revision is the one of the document's text
+    Speculation m_requested;
+
+
+    // completion contexts only get a const pointer to the worker
+    mutable QMutex m_lastCompletionLock;
+    mutable CompletionRequest m_lastRequest;
+    mutable bool m_hasLastCompletion = false;
+    mutable QList<CachedCompletionItem> m_lastItems;
+    mutable QList<CachedCompletionGroup> m_lastGroups;
+
+    /// runs one speculation at a time; destroyed first, so running ones finish while the rest still exists
+    QThreadPool m_speculationPool;
 };
 
 }
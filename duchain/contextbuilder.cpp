@@ -139,6 +139,16 @@ void ContextBuilder::setEditor(PythonEditorIntegrator* editor)
     m_editor = editor;
 }
 
+void ContextBuilder::setExpressionCache(ExpressionCache* cache)
+{
+    m_expressionCache = cache;
+}
+
+ExpressionCache* ContextBuilder::expressionCache() const
+{
+    return m_expressionCache;
+}
+
 void ContextBuilder::startVisiting(Ast* node)
 {
     visitNode(node);
@@ -314,6 +324,17 @@ void ContextBuilder::visitCode(CodeAst* node) {
             // KDevelop::ICore::self()->languageController()->backgroundParser()->parseDocuments();
         }
         else {
+            bool storesDocstringHints = false;
+            {
+                DUChainReadLocker lock;
+                storesDocstringHints = internal->features() & Helper::StoresDocstringHints;
+            }
+            if ( ! storesDocstringHints ) {
+                // Stored by an earlier version, without the docstring hints; use it until it is parsed again.
+                KDevelop::ICore::self()->languageController()->backgroundParser()
+                                       ->addDocument(doc, KDevelop::TopDUContext::ForceUpdate,
+                                                     BackgroundParser::BestPriority, 0, ParseJob::FullSequentialProcessing);
+            }
             DUChainWriteLocker wlock;
             currentContext()->addImportedParentContext(internal);
         }
@@ -35,6 +35,7 @@ namespace Python
 
 class PythonEditorIntegrator;
 class FileIndentInformation;
+class ExpressionCache;
 
 typedef KDevelop::AbstractContextBuilder<Ast, Identifier> ContextBuilderBase;
 
@@ -65,6 +66,17 @@ public:
      */
     void setFutureModificationRevision(const ModificationRevision& rev);
 
+    /**
+     * @brief Set the cache of expression results shared by all builders of a parse job.
+     * The cache is not owned by the builder; passing nullptr disables caching.
+     */
+    void setExpressionCache(ExpressionCache* cache);
+
+    /**
+     * @brief Get the shared cache of expression results, may be null.
+     */
+    ExpressionCache* expressionCache() const;
+
     /**
      * @brief Get the editor integrator.
      */
@@ -210,6 +222,7 @@ private:
     // The top-context being built.
     ReferencedTopDUContext m_topContext;
     PythonEditorIntegrator* m_editor = nullptr;
+    ExpressionCache* m_expressionCache = nullptr;
     QList<KDevelop::DUContext*> m_importedParentContexts;
     QSharedPointer<FileIndentInformation> m_indentInformationCache;
 };
@@ -0,0 +1,199 @@
+/*****************************************************************************
+ * Copyright (c) 2014 Sven Brauch <svenbrauch@gmail.com>                     *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or             *
+ * modify it under the terms of the GNU General Public License as            *
+ * published by the Free Software Foundation; either version 2 of            *
+ * the License, or (at your option) any later version.                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License for more details.                              *
+ *                                                                           *
+ * You should have received a copy of the GNU General Public License         *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.     *
+ *****************************************************************************
+ */
+
+#include "contextrangeindex.h"
+
+#include <language/duchain/topducontext.h>
+#include <language/duchain/parsingenvironment.h>
+
+#include <QHash>
+#include <QMutex>
+
+#include <algorithm>
+
+using namespace KDevelop;
+
+namespace Python
+{
+
+namespace {
+
+struct CachedIndex {
+    ModificationRevision revision;
+    QSharedPointer<const ContextRangeIndex> index;
+};
+
+const int maxCachedIndexes = 20;
+QHash<uint, CachedIndex> cachedIndexes;
+QMutex cachedIndexesLock;
+
+bool covers(const RangeInRevision& range, const CursorInRevision& position, bool includeRightBorder)
+{
+    return range.contains(position) || ( includeRightBorder && range.end == position );
+}
+
+/// The first line for which column 0 is inside @p range
+int firstCoveredLine(const RangeInRevision& range)
+{
+    return range.start.column > 0 ? range.start.line + 1 : range.start.line;
+}
+
+/// The last line for which column 0 is inside @p range, including its right border
+int lastCoveredLine(const RangeInRevision& range)
+{
+    return range.end.line >= firstCoveredLine(range) ? range.end.line : -1;
+}
+
+}
+
+ContextRangeIndex::ContextRangeIndex(TopDUContext* top)
+    : m_top(top)
+{
+    Node root;
+    root.range = top->range();
+    m_nodes.append(root);
+    addChildren(0, top);
+}
+
+void ContextRangeIndex::addChildren(int node, DUContext* context)
+{
+    QVector<DUContext*> children = context->childContexts();
+    // findContextAt() prefers the last child containing a position, keep their order for equal starts
+    std::stable_sort(children.begin(), children.end(), [](const DUContext* a, const DUContext* b) {
+        return a->range().start < b->range().start;
+    });
+    const int firstChild = m_children.size();
+    m_nodes[node].firstChild = firstChild;
+    m_nodes[node].childCount = children.size();
+    CursorInRevision maxEnd = CursorInRevision::invalid();
+    int maxCoveredLine = -1;
+    foreach ( DUContext* child, children ) {
+        Node childNode;
+        childNode.context = LocalIndexedDUContext(child);
+        childNode.range = child->range();
+        childNode.firstChild = 0;
+        childNode.childCount = 0;
+        if ( ! maxEnd.isValid() || maxEnd < childNode.range.end ) {
+            maxEnd = childNode.range.end;
+        }
+        maxCoveredLine = qMax(maxCoveredLine, lastCoveredLine(childNode.range));
+        m_children.append(m_nodes.size());
+        m_maxEnd.append(maxEnd);
+        m_maxCoveredLine.append(maxCoveredLine);
+        m_nodes.append(childNode);
+    }
+    // the children of each node are stored together, so add the grandchildren afterwards
+    for ( int i = 0; i < children.size(); i++ ) {
+        addChildren(m_children.at(firstChild + i), children.at(i));
+    }
+}
+
+QSharedPointer<const ContextRangeIndex> ContextRangeIndex::forTopContext(TopDUContext* top)
+{
+    ModificationRevision revision;
+    if ( ParsingEnvironmentFilePointer file = top->parsingEnvironmentFile() ) {
+        revision = file->modificationRevision();
+    }
+    QMutexLocker lock(&cachedIndexesLock);
+    auto it = cachedIndexes.constFind(top->ownIndex());
+    if ( it != cachedIndexes.constEnd() && it->revision == revision && it->index->topContext() == top ) {
+        return it->index;
+    }
+    if ( cachedIndexes.size() >= maxCachedIndexes ) {
+        cachedIndexes.clear();
+    }
+    CachedIndex cached;
+    cached.revision = revision;
+    cached.index = QSharedPointer<const ContextRangeIndex>(new ContextRangeIndex(top));
+    cachedIndexes.insert(top->ownIndex(), cached);
+    return cached.index;
+}
+
+int ContextRangeIndex::nodeAt(const CursorInRevision& position, bool includeRightBorder) const
+{
+    if ( ! covers(m_nodes.first().range, position, includeRightBorder) ) {
+        return -1;
+    }
+    int node = 0;
+    forever {
+        const Node& current = m_nodes.at(node);
+        const auto begin = m_children.constBegin() + current.firstChild;
+        const auto end = begin + current.childCount;
+        // the last child which starts at or before the position
+        const auto after = std::upper_bound(begin, end, position, [this](const CursorInRevision& cursor, int child) {
+            return cursor < m_nodes.at(child).range.start;
+        });
+        int found = -1;
+        for ( int i = ( after - m_children.constBegin() ) - 1; i >= current.firstChild; i-- ) {
+            // no child up to this one ends late enough to contain the position
+            if ( m_maxEnd.at(i) < position || ( ! includeRightBorder && m_maxEnd.at(i) == position ) ) {
+                break;
+            }
+            if ( covers(m_nodes.at(m_children.at(i)).range, position, includeRightBorder) ) {
+                found = m_children.at(i);
+                break;
+            }
+        }
+        if ( found == -1 ) {
+            return node;
+        }
+        node = found;
+    }
+}
+
+DUContext* ContextRangeIndex::contextAt(const CursorInRevision& position, bool includeRightBorder) const
+{
+    const int node = nodeAt(position, includeRightBorder);
+    if ( node == -1 ) {
+        return 0;
+    }
+    return contextOf(node);
+}
+
+DUContext* ContextRangeIndex::contextOf(int node) const
+{
+    // the top context is not stored by its local index
+    return node == 0 ? m_top : m_nodes.at(node).context.data(m_top);
+}
+
+int ContextRangeIndex::lastLineOutside(const DUContext* context, int line) const
+{
+    if ( line < 0 ) {
+        return -1;
+    }
+    const int node = nodeAt(CursorInRevision(line, 0), true);
+    if ( node == -1 || contextOf(node) != context ) {
+        return line;
+    }
+    const Node& current = m_nodes.at(node);
+    // Going up from the line, the context changes either at the last line inside one of its children,
+    // or right before its own first line.
+    int outside = firstCoveredLine(current.range) - 1;
+    const auto begin = m_children.constBegin() + current.firstChild;
+    const auto end = begin + current.childCount;
+    const auto after = std::upper_bound(begin, end, line, [this](int atLine, int child) {
+        return atLine < firstCoveredLine(m_nodes.at(child).range);
+    });
+    if ( after != begin ) {
+        const int lastChild = ( after - m_children.constBegin() ) - 1;
+        outside = qMax(outside, qMin(line, m_maxCoveredLine.at(lastChild)));
+    }
+    return outside;
+}
+
+}
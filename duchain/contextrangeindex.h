@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * Copyright (c) 2014 Sven Brauch <svenbrauch@gmail.com>                     *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or             *
+ * modify it under the terms of the GNU General Public License as            *
+ * published by the Free Software Foundation; either version 2 of            *
+ * the License, or (at your option) any later version.                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License for more details.                              *
+ *                                                                           *
+ * You should have received a copy of the GNU General Public License         *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.     *
+ *****************************************************************************
+ */
+
+#ifndef CONTEXTRANGEINDEX_H
+#define CONTEXTRANGEINDEX_H
+
+#include <QSharedPointer>
+#include <QVector>
+
+#include <language/duchain/ducontext.h>
+#include <language/duchain/localindexedducontext.h>
+
+#include "pythonduchainexport.h"
+
+namespace KDevelop {
+    class TopDUContext;
+}
+
+namespace Python
+{
+
+/**
+ * @brief The ranges of all contexts in a document, sorted for finding the context at a position quickly.
+ *
+ * The children of each context are sorted by their start, and each of them knows the largest end
+ * of the children up to it. A lookup is then a binary search on each nesting level, instead
+ * of checking every child like DUContext::findContextAt() does.
+ * The index is a snapshot of the contexts; it must be built again when they change.
+ */
+class KDEVPYTHONDUCHAIN_EXPORT ContextRangeIndex
+{
+public:
+    /**
+     * @brief Build the index for all contexts in @p top. The DUChain must be read-locked.
+     */
+    explicit ContextRangeIndex(KDevelop::TopDUContext* top);
+
+    /**
+     * @brief Get a shared index for @p top, which is built again when the document's revision changes.
+     * The DUChain must be read-locked.
+     */
+    static QSharedPointer<const ContextRangeIndex> forTopContext(KDevelop::TopDUContext* top);
+
+    /**
+     * @brief Get the innermost context at @p position, like findContextAt() on the top context.
+     * The DUChain must be read-locked.
+     */
+    KDevelop::DUContext* contextAt(const KDevelop::CursorInRevision& position, bool includeRightBorder = false) const;
+
+    /**
+     * @brief Find the last line up to @p line for which contextAt() at column 0 (including right borders)
+     * is not @p context; for example, to skip the blank lines at the end of a block.
+     * @return the line, or -1 if @p context is found for all lines up to @p line
+     */
+    int lastLineOutside(const KDevelop::DUContext* context, int line) const;
+
+    KDevelop::TopDUContext* topContext() const {
+        return m_top;
+    };
+
+private:
+    struct Node {
+        KDevelop::LocalIndexedDUContext context;
+        KDevelop::RangeInRevision range;
+        /// position of the first child in m_children, and the number of children
+        int firstChild;
+        int childCount;
+    };
+    void addChildren(int node, KDevelop::DUContext* context);
+    int nodeAt(const KDevelop::CursorInRevision& position, bool includeRightBorder) const;
+    KDevelop::DUContext* contextOf(int node) const;
+
+    KDevelop::TopDUContext* m_top;
+    QVector<Node> m_nodes;
+    /// node indices of the children of all nodes, each node's children sorted by start
+    QVector<int> m_children;
+    /// for each entry in m_children, the largest end of the siblings up to and including it
+    QVector<KDevelop::CursorInRevision> m_maxEnd;
+    /// for each entry in m_children, the largest line for which column 0 is inside one of the siblings up to it
+    QVector<int> m_maxCoveredLine;
+};
+
+}
+
+#endif // CONTEXTRANGEINDEX_H
@@ -28,6 +28,7 @@
 #include "types/indexedcontainer.h"
 #include "contextbuilder.h"
 #include "expressionvisitor.h"
+#include "expressioncache.h"
 #include "pythoneditorintegrator.h"
 #include "helpers.h"
 #include "assistants/missingincludeassistant.h"
@@ -46,6 +47,7 @@
 #include <language/backgroundparser/parsejob.h>
 #include <interfaces/ilanguagecontroller.h>
 
+#include <QAtomicInt>
 #include <QByteArray>
 #include <QtGlobal>
 #include <KUrl>
@@ -58,6 +60,12 @@ using namespace KDevelop;
 namespace Python
 {
 
+namespace {
+    // Totals for hintStatistics(), over all builders since the last resetHintStatistics()
+    QAtomicInt argumentHintCount;
+    QAtomicInt hintWriteLockCount;
+}
+
 DeclarationBuilder::DeclarationBuilder(Python::PythonEditorIntegrator* editor, int ownPriority)
     : DeclarationBuilderBase()
     , m_ownPriority(ownPriority)
@@ -77,11 +85,30 @@ DeclarationBuilder:: ~DeclarationBuilder()
     }
 }
 
+DeclarationBuilder::HintStatistics DeclarationBuilder::hintStatistics()
+{
+    HintStatistics statistics;
+    statistics.argumentHints = argumentHintCount.load();
+    statistics.writeLocks = hintWriteLockCount.load();
+    return statistics;
+}
+
+void DeclarationBuilder::resetHintStatistics()
+{
+    argumentHintCount.store(0);
+    hintWriteLockCount.store(0);
+}
+
 void DeclarationBuilder::setPrebuilding(bool prebuilding)
 {
     m_prebuilding = prebuilding;
 }
 
+void DeclarationBuilder::setHintGeneration(quint64 generation)
+{
+    m_hintGeneration = generation;
+}
+
 ReferencedTopDUContext DeclarationBuilder::build(const IndexedString& url, Ast* node, ReferencedTopDUContext updateContext)
 {
     m_correctionHelper.reset(new CorrectionHelper(url, this));
@@ -92,9 +119,11 @@ ReferencedTopDUContext DeclarationBuilder::build(const IndexedString& url, Ast*
         kDebug() << "building, but running pre-builder first";
         DeclarationBuilder* prebuilder = new DeclarationBuilder(editor());
         prebuilder->m_ownPriority = m_ownPriority;
+        prebuilder->m_hintGeneration = m_hintGeneration;
         prebuilder->m_currentlyParsedDocument = currentlyParsedDocument();
         prebuilder->setPrebuilding(true);
         prebuilder->m_futureModificationRevision = m_futureModificationRevision;
+        prebuilder->setExpressionCache(expressionCache());
         updateContext = prebuilder->build(url, node, updateContext);
         kDebug() << "pre-builder finished";
         delete prebuilder;
@@ -102,7 +131,21 @@ ReferencedTopDUContext DeclarationBuilder::build(const IndexedString& url, Ast*
     else {
         kDebug() << "prebuilding";
     }
-    return DeclarationBuilderBase::build(url, node, updateContext);
+    ReferencedTopDUContext top = DeclarationBuilderBase::build(url, node, updateContext);
+    // contexts which were not closed regularly (e.g. because they were deleted) must not leave entries behind
+    m_existingDeclarations.clear();
+    applyArgumentTypeHints();
+    return top;
+}
+
+void DeclarationBuilder::visitNode(Ast* node)
+{
+    // This builder changes declarations and types while it walks the tree, so cached
+    // expression results are only kept while a single statement is being processed.
+    if ( node && ! node->isExpression() && expressionCache() ) {
+        expressionCache()->clear();
+    }
+    DeclarationBuilderBase::visitNode(node);
 }
 
 int DeclarationBuilder::jobPriority() const
@@ -110,6 +153,21 @@ int DeclarationBuilder::jobPriority() const
     return m_ownPriority;
 }
 
+void DeclarationBuilder::closeContext()
+{
+    // declarations which were not encountered are deleted when the context is closed
+    m_existingDeclarations.remove(IndexedDUContext(currentContext()));
+    DeclarationBuilderBase::closeContext();
+}
+
+void DeclarationBuilder::forgetExistingDeclarations(const KDevelop::Identifier& identifier)
+{
+    auto it = m_existingDeclarations.find(IndexedDUContext(currentContext()));
+    if ( it != m_existingDeclarations.end() ) {
+        it->remove(identifier.toString());
+    }
+}
+
 void DeclarationBuilder::closeDeclaration()
 {
     if ( lastContext() ) {
@@ -175,10 +233,18 @@ template<typename T> T* DeclarationBuilder::visitVariableDeclaration(Identifier*
 
 QList< Declaration* > DeclarationBuilder::existingDeclarationsForNode(Identifier* node)
 {
-    QList<Declaration*> existingDeclarations = currentContext()->findDeclarations(
-        identifierForNode(node).last(), CursorInRevision::invalid(), 0,
-        (DUContext::SearchFlag) (DUContext::DontSearchInParent | DUContext::DontResolveAliases)
-    );
+    const KDevelop::Identifier identifier = identifierForNode(node).last();
+    // The result only changes if a declaration with this name is opened in the context,
+    // or when the context is closed, so it is kept until then; names are often assigned to many times.
+    QHash<QString, QList<Declaration*>>& known = m_existingDeclarations[IndexedDUContext(currentContext())];
+    auto it = known.constFind(identifier.toString());
+    if ( it == known.constEnd() ) {
+        it = known.insert(identifier.toString(), currentContext()->findDeclarations(
+            identifier, CursorInRevision::invalid(), 0,
+            (DUContext::SearchFlag) (DUContext::DontSearchInParent | DUContext::DontResolveAliases)
+        ));
+    }
+    QList<Declaration*> existingDeclarations = *it;
     // append arguments context
     if ( m_mostRecentArgumentsContext ) {
         QList<Declaration*> args = m_mostRecentArgumentsContext->findDeclarations(
@@ -918,10 +984,7 @@ void DeclarationBuilder::applyDocstringHints(CallAst* node, FunctionDeclaration:
         return;
     }
     // Check for the different types of modifiers such a function can have
-    QStringList args;
-    QHash< QString, std::function<void()> > items;
-    items["addsTypeOfArg"] = [&]() {
-        const int offset = ! args.isEmpty() ? args.at(0).toInt() : 0;
+    auto addsTypeOfArg = [&](int offset) {
         if ( node->arguments.length() <= offset ) {
             return;
         }
@@ -933,18 +996,19 @@ void DeclarationBuilder::applyDocstringHints(CallAst* node, FunctionDeclaration:
             return;
         }
         DUChainWriteLocker wlock;
+        hintWriteLockCount.fetchAndAddRelaxed(1);
         kDebug() << "Adding content type: " << argVisitor.lastType()->toString();
         container->addContentType<Python::UnsureType>(argVisitor.lastType());
         v.lastDeclaration()->setType(container);
     };
-    items["addsTypeOfArgContent"] = [&]() {
-        const int offset = ! args.isEmpty() ? args.at(0).toInt() : 0;
+    auto addsTypeOfArgContent = [&](int offset) {
         if ( node->arguments.length() <= offset ) {
             return;
         }
         ExpressionVisitor argVisitor(currentContext());
         argVisitor.visitNode(node->arguments.at(offset));
         DUChainWriteLocker wlock;
+        hintWriteLockCount.fetchAndAddRelaxed(1);
         if ( ! argVisitor.lastType() ) {
             return;
         }
@@ -962,9 +1026,25 @@ void DeclarationBuilder::applyDocstringHints(CallAst* node, FunctionDeclaration:
         }
     };
 
-    foreach ( const QString& key, items.keys() ) {
-        if ( Helper::docstringContainsHint(function.data(), key, &args) ) {
-            items[key]();
+    // The hints were parsed when the function was declared; copy them, since the handlers
+    // take the write lock and thus may change the data of the declaration.
+    QVector<DocstringHint> hints;
+    {
+        DUChainReadLocker lock;
+        for ( uint i = 0; i < function->docstringHintsSize(); i++ ) {
+            hints.append(function->docstringHints()[i]);
+        }
+    }
+    foreach ( const DocstringHint& hint, hints ) {
+        switch ( hint.kind() ) {
+            case DocstringHint::AddsTypeOfArg:
+                addsTypeOfArg(hint.argument());
+                break;
+            case DocstringHint::AddsTypeOfArgContent:
+                addsTypeOfArgContent(hint.argument());
+                break;
+            default:
+                break;
         }
     }
 }
@@ -1009,95 +1089,139 @@ void DeclarationBuilder::addArgumentTypeHints(CallAst* node, DeclarationPointer
     int paramsAvailable = qMin(functiontype->arguments().length() + hasSelfArgument, parameters.size());
     int argsAvailable = node->arguments.size();
     bool atVararg = false;
+    const int vararg = lastFunctionDeclaration->vararg();
+    const bool hasKeywordParameter = lastFunctionDeclaration->kwarg() >= 0 && ! parameters.isEmpty()
+                                     && parameters.last()->abstractType().cast<ListType>();
 
-    lock.unlock();
-
-    // Iterate over all the arguments, trying to guess the type of the object being
-    // passed as an argument, and update the parameter accordingly.
-    // Stop if more parameters supplied than possible, and we're not at the vararg.
-    for ( ; ( atVararg || currentParamIndex < paramsAvailable ) && currentArgumentIndex < argsAvailable;
-            currentParamIndex++, currentArgumentIndex++ )
-    {
-        if ( ! atVararg && currentArgumentIndex == lastFunctionDeclaration->vararg() ) {
-            atVararg = true;
-        }
-
-        kDebug() << currentParamIndex << currentArgumentIndex << atVararg << lastFunctionDeclaration->vararg();
+    CallSiteSummary& summary = m_callSiteSummaries[IndexedDeclaration(lastFunctionDeclaration.data())];
+    summary.varargParameter = vararg + hasSelfArgument;
 
-        ExpressionAst* arg = node->arguments.at(currentArgumentIndex);
+    lock.unlock();
 
+    auto hintForArgument = [this](ExpressionAst* arg) {
         ExpressionVisitor argumentVisitor(currentContext());
         argumentVisitor.visitNode(arg);
-        AbstractType::Ptr argumentType = argumentVisitor.lastType();
-
-        // Update the parameter type: change both the type of the function argument,
-        // and the type of the declaration which belongs to that argument
         HintedType::Ptr addType = HintedType::Ptr(new HintedType());
         openType(addType);
         addType->setType(argumentVisitor.lastType());
         addType->setCreatedBy(topContext(), m_futureModificationRevision);
         closeType();
+        m_createdHints.append(addType->indexed());
+        return qMakePair(argumentVisitor.lastType(), addType.cast<AbstractType>());
+    };
 
-        // Update the parameter type: change both the type of the function argument,
-        // and the type of the declaration which belongs to that argument
-        DUChainWriteLocker wlock;
+    // Iterate over all the arguments, trying to guess the type of the object being
+    // passed as an argument, and remember it for the parameter.
+    // Stop if more parameters supplied than possible, and we're not at the vararg.
+    for ( ; ( atVararg || currentParamIndex < paramsAvailable ) && currentArgumentIndex < argsAvailable;
+            currentParamIndex++, currentArgumentIndex++ )
+    {
+        if ( ! atVararg && currentArgumentIndex == vararg ) {
+            atVararg = true;
+        }
+
+        auto hint = hintForArgument(node->arguments.at(currentArgumentIndex));
         if ( atVararg ) {
             indexInVararg++;
-            Declaration* parameter = parameters.at(lastFunctionDeclaration->vararg()+hasSelfArgument);
-            IndexedContainer::Ptr varargContainer = parameter->type<IndexedContainer>();
-            kDebug() << "vararg container:" << varargContainer;
-            kDebug() << "adding" << addType->toString() << "at position" << indexInVararg;
-            if ( ! varargContainer ) continue;
-            if ( varargContainer->typesCount() > indexInVararg ) {
-                AbstractType::Ptr oldType = varargContainer->typeAt(indexInVararg).abstractType();
-                AbstractType::Ptr newType = Helper::mergeTypes(oldType, addType.cast<AbstractType>());
-                varargContainer->replaceType(indexInVararg, newType);
+            if ( summary.varargs.size() > indexInVararg ) {
+                summary.varargs[indexInVararg] = Helper::mergeTypes(summary.varargs.at(indexInVararg), hint.second);
             }
             else {
-                varargContainer->addEntry(addType.cast<AbstractType>());
+                summary.varargs.append(hint.second);
             }
-            parameter->setAbstractType(varargContainer.cast<AbstractType>());
         }
         else {
-            kDebug() << "adding" << argumentType << "at position" << currentArgumentIndex << "/" << currentParamIndex;
-            if ( ! argumentType ) continue;
-            AbstractType::Ptr newType = Helper::mergeTypes(parameters.at(currentParamIndex)->abstractType(),
-                                                            addType.cast<AbstractType>());
-            // TODO this does not correctly update the types in quickopen! Investigate why.
-            functiontype->removeArgument(currentArgumentIndex + hasSelfArgument);
-            functiontype->addArgument(newType, currentArgumentIndex + hasSelfArgument);
-            lastFunctionDeclaration->setAbstractType(functiontype.cast<AbstractType>());
-            parameters.at(currentParamIndex)->setType(newType);
+            if ( ! hint.first ) continue;
+            AbstractType::Ptr& parameterHint = summary.parameters[currentParamIndex];
+            parameterHint = parameterHint ? Helper::mergeTypes(parameterHint, hint.second) : hint.second;
         }
+        argumentHintCount.fetchAndAddRelaxed(1);
     }
 
-    lock.unlock();
-    DUChainWriteLocker wlock;
-    if ( lastFunctionDeclaration->kwarg() < 0 || parameters.isEmpty() ) {
+    if ( ! hasKeywordParameter ) {
         // no kwarg, stop here.
         return;
     }
     foreach ( KeywordAst* keyword, node->keywords ) {
-        AbstractType::Ptr param = parameters.last()->abstractType();
-        auto list = param.cast<ListType>();
-        if ( ! list ) {
+        auto hint = hintForArgument(keyword->value);
+        if ( ! hint.first ) {
             continue;
         }
-        wlock.unlock();
-        ExpressionVisitor argumentVisitor(currentContext());
-        argumentVisitor.visitNode(keyword->value);
-        if ( ! argumentVisitor.lastType() ) {
+        summary.keywords.append(hint.second);
+        argumentHintCount.fetchAndAddRelaxed(1);
+    }
+}
+
+void DeclarationBuilder::applyArgumentTypeHints()
+{
+    if ( m_callSiteSummaries.isEmpty() ) {
+        return;
+    }
+    // One write lock for all the functions called from this document, instead of one for each argument.
+    DUChainWriteLocker lock;
+    hintWriteLockCount.fetchAndAddRelaxed(1);
+    HintedType::setGeneration(m_createdHints, m_hintGeneration);
+    m_createdHints.clear();
+    for ( auto it = m_callSiteSummaries.constBegin(); it != m_callSiteSummaries.constEnd(); it++ ) {
+        FunctionDeclaration* function = dynamic_cast<FunctionDeclaration*>(it.key().declaration());
+        if ( ! function ) {
             continue;
         }
-        wlock.lock();
-        HintedType::Ptr addType = HintedType::Ptr(new HintedType());
-        openType(addType);
-        addType->setType(argumentVisitor.lastType());
-        addType->setCreatedBy(topContext(), m_futureModificationRevision);
-        closeType();
-        list->addContentType<Python::UnsureType>(addType.cast<AbstractType>());
-        parameters.last()->setAbstractType(list.cast<AbstractType>());
+        DUContext* args = DUChainUtils::getArgumentContext(function);
+        FunctionType::Ptr functiontype = function->type<FunctionType>();
+        if ( ! args || ! functiontype ) {
+            continue;
+        }
+        const CallSiteSummary& summary = it.value();
+        QVector<Declaration*> parameters = args->localDeclarations();
+
+        // Update the parameter types: change both the type of the function argument,
+        // and the type of the declaration which belongs to that argument
+        for ( auto param = summary.parameters.constBegin(); param != summary.parameters.constEnd(); param++ ) {
+            if ( param.key() >= parameters.size() ) {
+                continue;
+            }
+            AbstractType::Ptr newType = Helper::mergeTypes(parameters.at(param.key())->abstractType(), param.value());
+            // TODO this does not correctly update the types in quickopen! Investigate why.
+            functiontype->removeArgument(param.key());
+            functiontype->addArgument(newType, param.key());
+            parameters.at(param.key())->setType(newType);
+            HintedType::registerHintTarget(topContext()->indexed(), IndexedDeclaration(parameters.at(param.key())));
+        }
+        if ( ! summary.parameters.isEmpty() ) {
+            function->setAbstractType(functiontype.cast<AbstractType>());
+        }
+
+        if ( ! summary.varargs.isEmpty() && summary.varargParameter >= 0
+             && summary.varargParameter < parameters.size() )
+        {
+            Declaration* parameter = parameters.at(summary.varargParameter);
+            if ( IndexedContainer::Ptr varargContainer = parameter->type<IndexedContainer>() ) {
+                for ( int i = 0; i < summary.varargs.size(); i++ ) {
+                    if ( varargContainer->typesCount() > i ) {
+                        AbstractType::Ptr oldType = varargContainer->typeAt(i).abstractType();
+                        varargContainer->replaceType(i, Helper::mergeTypes(oldType, summary.varargs.at(i)));
+                    }
+                    else {
+                        varargContainer->addEntry(summary.varargs.at(i));
+                    }
+                }
+                parameter->setAbstractType(varargContainer.cast<AbstractType>());
+                HintedType::registerHintTarget(topContext()->indexed(), IndexedDeclaration(parameter));
+            }
+        }
+
+        if ( ! summary.keywords.isEmpty() && ! parameters.isEmpty() ) {
+            if ( auto list = parameters.last()->abstractType().cast<ListType>() ) {
+                foreach ( const AbstractType::Ptr& hint, summary.keywords ) {
+                    list->addContentType<Python::UnsureType>(hint);
+                }
+                parameters.last()->setAbstractType(list.cast<AbstractType>());
+                HintedType::registerHintTarget(topContext()->indexed(), IndexedDeclaration(parameters.last()));
+            }
+        }
     }
+    m_callSiteSummaries.clear();
 }
 
 void DeclarationBuilder::visitCall(CallAst* node)
@@ -1111,6 +1235,7 @@ void DeclarationBuilder::visitCall(CallAst* node)
     //     x = l[0].myfun() # the called object is actually l[0].myfun
     // In the above example, this call will be evaluated to "myclass.myfun" in the following statement.
     ExpressionVisitor functionVisitor(currentContext());
+    functionVisitor.setCache(expressionCache());
     functionVisitor.visitNode(node);
 
     if ( node->function && node->function->astType == Ast::AttributeAstType && functionVisitor.lastDeclaration() ) {
@@ -1118,6 +1243,9 @@ void DeclarationBuilder::visitCall(CallAst* node)
         // Find the object the function is called on, like for d = [1, 2, 3]; d.append(5), this will give "d"
         FunctionDeclaration::Ptr function = functionVisitor.lastDeclaration().dynamicCast<FunctionDeclaration>();
         applyDocstringHints(node, function);
+        if ( expressionCache() ) {
+            expressionCache()->clear();
+        }
     }
     if ( ! m_prebuilding ) {
         return;
@@ -1130,6 +1258,9 @@ void DeclarationBuilder::visitCall(CallAst* node)
     //     foo(3)
     // the following will change the type of "arg" to be "int" when it processes the second line.
     addArgumentTypeHints(node, functionVisitor.lastDeclaration());
+    if ( expressionCache() ) {
+        expressionCache()->clear();
+    }
 }
 
 QList<ExpressionAst*> DeclarationBuilder::targetsOfAssignment(QList<ExpressionAst*> targets) const
@@ -1171,6 +1302,7 @@ QList<DeclarationBuilder::SourceType> DeclarationBuilder::sourcesOfAssignment(Ex
         // in the right operand; so all elements are treated to have the same type.
         if ( fillWhenLengthMissing > 0 ) {
             ExpressionVisitor v(currentContext());
+            v.setCache(expressionCache());
             v.visitNode(items);
             auto container = ListType::Ptr::dynamicCast(v.lastType());
             if ( container ) {
@@ -1188,6 +1320,7 @@ QList<DeclarationBuilder::SourceType> DeclarationBuilder::sourcesOfAssignment(Ex
 
     foreach ( ExpressionAst* value, values ) {
         ExpressionVisitor v(currentContext());
+        v.setCache(expressionCache());
         v.visitNode(value);
 
         sources << SourceType{
@@ -1215,6 +1348,7 @@ DeclarationBuilder::SourceType DeclarationBuilder::selectSource(const QList<Expr
     }
     else if ( targets.length() == 1 ) {
         ExpressionVisitor v(currentContext());
+        v.setCache(expressionCache());
         v.visitNode(rhs);
         element = SourceType{
             v.lastType(),
@@ -1409,6 +1543,10 @@ void DeclarationBuilder::visitClassDefinition( ClassDefinitionAst* node )
     eventuallyAssignInternalContext();
     
     dec->setKind(KDevelop::Declaration::Type);
+    QList<IndexedType> previousBaseClasses;
+    FOREACH_FUNCTION ( const BaseClassInstance& base, dec->baseClasses ) {
+        previousBaseClasses << base.baseClass;
+    }
     dec->clearBaseClasses();
     dec->setClassType(ClassDeclarationData::Class);
     
@@ -1464,6 +1602,14 @@ void DeclarationBuilder::visitClassDefinition( ClassDefinitionAst* node )
             }
         }
     }
+    QList<IndexedType> baseClasses;
+    FOREACH_FUNCTION ( const BaseClassInstance& base, dec->baseClasses ) {
+        baseClasses << base.baseClass;
+    }
+    if ( baseClasses != previousBaseClasses ) {
+        // the cached method resolution order of this class and its subclasses is outdated
+        Helper::invalidateClassHierarchy(dec);
+    }
     
     type->setDeclaration(dec);
     dec->setType(type);
@@ -1534,7 +1680,9 @@ void DeclarationBuilder::visitFunctionDefinition( FunctionDefinitionAst* node )
     Q_ASSERT(dec->isFunctionDeclaration());
     
     // check for documentation
-    dec->setComment(getDocstring(node->body));
+    const QString docstring = getDocstring(node->body);
+    dec->setComment(docstring);
+    dec->setDocstringHints(DocstringHint::parse(docstring));
     
     openType(type);
     dec->setInSymbolTable(false);
@@ -22,8 +22,12 @@
 #define PYTHON_DECLARATIONBUILDER_H
 
 #include <language/duchain/builders/abstractdeclarationbuilder.h>
+#include <language/duchain/indexeddeclaration.h>
+#include <language/duchain/indexedducontext.h>
 
 #include <QList>
+#include <QMap>
+#include <QHash>
 
 #include "declarations/functiondeclaration.h"
 #include "typebuilder.h"
@@ -54,6 +58,23 @@ public:
      */
     void setPrebuilding(bool prebuilding);
 
+    /**
+     * @brief Set the generation the type hints created by this builder belong to, see HintedType::newGeneration().
+     */
+    void setHintGeneration(quint64 generation);
+
+    /// Number of argument type hints collected, and of write locks taken to store type hints
+    struct HintStatistics {
+        int argumentHints;
+        int writeLocks;
+    };
+
+    /**
+     * @brief Totals of all declaration builders since the last call to resetHintStatistics(); used by the benchmarks.
+     */
+    static HintStatistics hintStatistics();
+    static void resetHintStatistics();
+
     /**
      * @brief Priority of this parse job.
      */
@@ -76,6 +97,7 @@ public:
 
 protected:
     /// AST visitor functions
+    virtual void visitNode(Ast* node);
     virtual void visitClassDefinition(ClassDefinitionAst* node);
     virtual void visitFunctionDefinition(FunctionDefinitionAst* node);
     virtual void visitAssignment(AssignmentAst* node);
@@ -116,14 +138,24 @@ protected:
     void applyDocstringHints(CallAst* node, Python::FunctionDeclaration::Ptr function);
 
     /**
-     * @brief Try to deduce types of function arguments from a call and stores it in the duchain
+     * @brief Try to deduce types of function arguments from a call and remember them for the called function
      * @param node the called function
      * @param function the declaration which belongs to @p node
      *
-     * Used for example in def f(x): pass; a = f(3) to set the type of x to "int"
+     * Used for example in def f(x): pass; a = f(3) to set the type of x to "int".
+     * The types are only written to the duchain by applyArgumentTypeHints().
      */
     void addArgumentTypeHints(CallAst* node, DeclarationPointer function);
 
+    /**
+     * @brief Store the argument types collected by addArgumentTypeHints() in the called functions.
+     *
+     * Called once at the end of each pass, so all call sites of a document are handled with a
+     * single write lock. Consequently, the hints from a call only become visible to the following
+     * code in the next pass, not directly after the call as they would with one lock per call.
+     */
+    void applyArgumentTypeHints();
+
     /**
      * @brief Adjust the type of foo in an expression like assert isinstance(fooinstance, Foo)
      * Does nothing if the given expression isn't of any of the forms
@@ -267,6 +299,7 @@ protected:
 private:
     template<class T> T* openDeclaration(Identifier* name, Ast* range, DeclarationFlags flags = NoFlags)
     {
+        forgetExistingDeclarations(identifierForNode(name).last());
         T* decl = DeclarationBuilderBase::openDeclaration<T>(name, range, flags);
         decl->setAlwaysForceDirect(true);
         return decl;
@@ -274,18 +307,40 @@ private:
     template<class T> T* openDeclaration(const QualifiedIdentifier& id, const RangeInRevision& newRange,
                                          DeclarationFlags flags = NoFlags)
     {
+        forgetExistingDeclarations(id.last());
         T* decl = DeclarationBuilderBase::openDeclaration<T>(id, newRange, flags);
         decl->setAlwaysForceDirect(true);
         return decl;
     };
     virtual void closeDeclaration();
+    virtual void closeContext();
+
+    /// Drop the cached result of existingDeclarationsForNode() for @p identifier in the current context.
+    void forgetExistingDeclarations(const KDevelop::Identifier& identifier);
 
 private:
     /// HACK: List of items to delete after parsing finishes, to work around the built-in cleanup logic
     QList<DUChainBase*> m_scheduledForDeletion;
     QScopedPointer<CorrectionHelper> m_correctionHelper;
     int m_ownPriority = 0;
+    quint64 m_hintGeneration = 0;
     StructureType::Ptr m_currentClassType;
+
+    /// Argument types seen at the call sites of one function
+    struct CallSiteSummary {
+        /// merged hints by index of the parameter
+        QMap<int, AbstractType::Ptr> parameters;
+        /// merged hints by position in the *args tuple
+        QList<AbstractType::Ptr> varargs;
+        int varargParameter = -1;
+        /// hints for the content of **kwargs
+        QList<AbstractType::Ptr> keywords;
+    };
+    QHash<IndexedDeclaration, CallSiteSummary> m_callSiteSummaries;
+    /// Hints created since they were last applied, see HintedType::setGeneration()
+    QVector<IndexedType> m_createdHints;
+    /// Results of existingDeclarationsForNode(), by context and name; see there. Cleared after each pass.
+    QHash<IndexedDUContext, QHash<QString, QList<Declaration*>>> m_existingDeclarations;
 };
 
 }
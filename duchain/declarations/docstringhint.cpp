@@ -0,0 +1,66 @@
+/***************************************************************************
+ *   This file is part of KDevelop                                         *
+ *   Copyright (c) 2014 Sven Brauch <svenbrauch@gmail.com>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "docstringhint.h"
+
+namespace Python {
+
+QVector<DocstringHint> DocstringHint::parse(const QString& comment)
+{
+    struct Name {
+        Kind kind;
+        const char* name;
+    };
+    static const Name names[] = {
+        { AddsTypeOfArg, "addsTypeOfArg" },
+        { AddsTypeOfArgContent, "addsTypeOfArgContent" },
+        { GetsType, "getsType" },
+        { GetsList, "getsList" },
+        { GetListOfKeys, "getListOfKeys" },
+        { GetsListOfBoth, "getsListOfBoth" },
+        { Enumerate, "enumerate" },
+        { ReturnContentEqualsContentOf, "returnContentEqualsContentOf" }
+    };
+    QVector<DocstringHint> hints;
+    if ( ! comment.contains(QLatin1String("! ")) ) {
+        return hints;
+    }
+    QVector<int> positions;
+    for ( const Name& name: names ) {
+        const QString search = QLatin1String("! ") + QLatin1String(name.name) + QLatin1String(" !");
+        const int index = comment.indexOf(search);
+        if ( index < 0 ) {
+            continue;
+        }
+        const int eol = comment.indexOf('\n', index);
+        const int start = index + search.size() + 1;
+        const QString argument = comment.mid(start, eol - start).section(' ', 0, 0);
+        // keep the hints sorted by their position in the docstring
+        int insertAt = 0;
+        while ( insertAt < positions.size() && positions.at(insertAt) < index ) {
+            insertAt++;
+        }
+        positions.insert(insertAt, index);
+        hints.insert(insertAt, DocstringHint(name.kind, argument.toShort()));
+    }
+    return hints;
+}
+
+}
@@ -0,0 +1,73 @@
+/***************************************************************************
+ *   This file is part of KDevelop                                         *
+ *   Copyright (c) 2014 Sven Brauch <svenbrauch@gmail.com>                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program; if not, write to the                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef DOCSTRINGHINT_H
+#define DOCSTRINGHINT_H
+
+#include <QString>
+#include <QVector>
+
+#include "pythonduchainexport.h"
+
+namespace Python {
+
+/**
+ * @brief A type hint from the documentation files, like "! addsTypeOfArg ! 1" in a docstring.
+ *
+ * The hints are parsed once when the declaration is built, and stored as a kind
+ * plus an optional integer argument (0 if none is given), which is all the existing hints need.
+ **/
+class KDEVPYTHONDUCHAIN_EXPORT DocstringHint {
+public:
+    enum Kind {
+        Invalid = 0,
+        AddsTypeOfArg,
+        AddsTypeOfArgContent,
+        GetsType,
+        GetsList,
+        GetListOfKeys,
+        GetsListOfBoth,
+        Enumerate,
+        ReturnContentEqualsContentOf
+    };
+
+    DocstringHint() : m_kind(Invalid), m_argument(0) { };
+    DocstringHint(Kind kind, short argument) : m_kind(kind), m_argument(argument) { };
+
+    inline Kind kind() const {
+        return static_cast<Kind>(m_kind);
+    }
+    inline short argument() const {
+        return m_argument;
+    }
+
+    /**
+     * @brief Find all hints in @p comment, in the order in which they are listed in the docstring.
+     **/
+    static QVector<DocstringHint> parse(const QString& comment);
+
+private:
+    unsigned char m_kind;
+    short m_argument;
+};
+
+}
+
+#endif
@@ -23,6 +23,7 @@
 namespace Python {
 
 DEFINE_LIST_MEMBER_HASH(FunctionDeclarationData, m_decorators, Decorator);
+DEFINE_LIST_MEMBER_HASH(FunctionDeclarationData, m_docstringHints, DocstringHint);
 REGISTER_DUCHAIN_ITEM(FunctionDeclaration);
 
 FunctionDeclaration::FunctionDeclaration(const FunctionDeclaration& rhs)
@@ -25,10 +25,12 @@
 
 #include "pythonduchainexport.h"
 #include "decorator.h"
+#include "docstringhint.h"
 
 namespace Python {
 
 KDEVPYTHONDUCHAIN_EXPORT DECLARE_LIST_MEMBER_HASH(FunctionDeclarationData, m_decorators, Decorator);
+KDEVPYTHONDUCHAIN_EXPORT DECLARE_LIST_MEMBER_HASH(FunctionDeclarationData, m_docstringHints, DocstringHint);
 
 class KDEVPYTHONDUCHAIN_EXPORT FunctionDeclarationData : public KDevelop::FunctionDeclarationData
 {
@@ -62,7 +64,8 @@ public:
 
     START_APPENDED_LISTS_BASE(FunctionDeclarationData, KDevelop::FunctionDeclarationData);
     APPENDED_LIST_FIRST(FunctionDeclarationData, Decorator, m_decorators);
-    END_APPENDED_LISTS(FunctionDeclarationData, m_decorators);
+    APPENDED_LIST(FunctionDeclarationData, DocstringHint, m_docstringHints, m_decorators);
+    END_APPENDED_LISTS(FunctionDeclarationData, m_docstringHints);
 };
 
 class KDEVPYTHONDUCHAIN_EXPORT FunctionDeclaration : public KDevelop::FunctionDeclaration
@@ -113,6 +116,22 @@ public:
     inline void addDecorator(const Decorator& d) {
         d_func_dynamic()->m_decoratorsList().insert(0, d);
     }
+
+    /// The type hints from this function's docstring, as parsed by DocstringHint::parse().
+    inline const DocstringHint* docstringHints() const {
+        return d_func()->m_docstringHints();
+    };
+
+    inline unsigned int docstringHintsSize() const {
+        return d_func()->m_docstringHintsSize();
+    };
+
+    inline void setDocstringHints(const QVector<DocstringHint>& hints) {
+        d_func_dynamic()->m_docstringHintsList().clear();
+        foreach ( const DocstringHint& hint, hints ) {
+            d_func_dynamic()->m_docstringHintsList().append(hint);
+        }
+    }
     
     typedef DUChainPointer<FunctionDeclaration> Ptr;
     
@@ -0,0 +1,93 @@
+/*****************************************************************************
+ * Copyright (c) 2014 Sven Brauch <svenbrauch@gmail.com>                     *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or             *
+ * modify it under the terms of the GNU General Public License as            *
+ * published by the Free Software Foundation; either version 2 of            *
+ * the License, or (at your option) any later version.                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License for more details.                              *
+ *                                                                           *
+ * You should have received a copy of the GNU General Public License         *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.     *
+ *****************************************************************************
+ */
+
+// Parses the given python files and directories, and prints how much memory the DUChain
+// uses for each of them, largest first.
+// Usage: duchainmemory [--top N] file-or-directory...
+
+#include <language/duchain/duchain.h>
+#include <language/duchain/topducontext.h>
+#include <language/backgroundparser/backgroundparser.h>
+#include <interfaces/ilanguagecontroller.h>
+#include <tests/autotestshell.h>
+#include <tests/testcore.h>
+
+#include <QApplication>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+
+#include "dumpchain.h"
+
+using namespace KDevelop;
+using namespace Python;
+
+int main(int argc, char** argv)
+{
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    int top = 20;
+    QStringList files;
+    QStringList arguments = app.arguments().mid(1);
+    while ( ! arguments.isEmpty() ) {
+        const QString argument = arguments.takeFirst();
+        if ( argument == "--top" && ! arguments.isEmpty() ) {
+            top = arguments.takeFirst().toInt();
+            continue;
+        }
+        QFileInfo info(argument);
+        if ( info.isDir() ) {
+            QDirIterator it(info.absoluteFilePath(), QStringList() << "*.py", QDir::Files, QDirIterator::Subdirectories);
+            while ( it.hasNext() ) {
+                files << it.next();
+            }
+        }
+        else if ( info.exists() ) {
+            files << info.absoluteFilePath();
+        }
+    }
+    if ( files.isEmpty() ) {
+        out << "Usage: duchainmemory [--top N] file-or-directory..." << endl;
+        return 1;
+    }
+
+    AutoTestShell::init();
+    TestCore* core = new TestCore();
+    core->initialize(KDevelop::Core::NoUi);
+    DUChain::self()->disablePersistentStorage();
+
+    foreach ( const QString& file, files ) {
+        DUChain::self()->updateContextForUrl(IndexedString(file), TopDUContext::AllDeclarationsContextsAndUses);
+    }
+    ICore::self()->languageController()->backgroundParser()->parseDocuments();
+    foreach ( const QString& file, files ) {
+        DUChain::self()->waitForUpdate(IndexedString(file), TopDUContext::AllDeclarationsContextsAndUses);
+    }
+    while ( ICore::self()->languageController()->backgroundParser()->queuedCount() > 0 ) {
+        app.processEvents();
+        QThread::msleep(10);
+    }
+
+    // imported modules and the documentation files are part of the report as well
+    DumpChain::printMemoryUsage(out, DumpChain::largestDocuments(top));
+
+    TestCore::shutdown();
+    return 0;
+}
@@ -22,6 +22,11 @@
  *****************************************************************************/
 #include "dumpchain.h"
 #include "pythoneditorintegrator.h"
+#include "declarations/functiondeclaration.h"
+#include "declarations/classdeclaration.h"
+#include "types/hintedtype.h"
+#include "types/unsuretype.h"
+#include "types/indexedcontainer.h"
 
 #include <language/duchain/types/identifiedtype.h>
 #include <language/duchain/ducontext.h>
@@ -29,11 +34,155 @@
 #include <language/duchain/declaration.h>
 #include <language/duchain/duchainpointer.h>
 #include <language/duchain/use.h>
+#include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/declarationdata.h>
+#include <language/duchain/ducontextdata.h>
+#include <language/duchain/problem.h>
+#include <language/duchain/parsingenvironment.h>
+#include <language/duchain/types/functiontype.h>
+#include <language/duchain/types/containertypes.h>
+
+#include <QSet>
+
+#include <algorithm>
 
 using namespace KDevelop;
 
 namespace Python {
 
+namespace {
+    void addTypeUsage(const IndexedType& indexed, QSet<uint>* seen, MemoryUsage* usage)
+    {
+        if ( ! indexed.isValid() || seen->contains(indexed.index()) ) {
+            return;
+        }
+        seen->insert(indexed.index());
+        AbstractType::Ptr type = indexed.abstractType();
+        if ( HintedType::Ptr hinted = type.cast<HintedType>() ) {
+            usage->hintedTypes += sizeof(HintedTypeData);
+            addTypeUsage(IndexedType(hinted->type()), seen, usage);
+        }
+        else if ( KDevelop::UnsureType::Ptr unsure = type.cast<KDevelop::UnsureType>() ) {
+            usage->unsureTypes += sizeof(KDevelop::UnsureTypeData) + unsure->typesSize() * sizeof(IndexedType);
+            for ( uint i = 0; i < unsure->typesSize(); i++ ) {
+                addTypeUsage(unsure->types()[i], seen, usage);
+            }
+        }
+        else if ( IndexedContainer::Ptr container = type.cast<IndexedContainer>() ) {
+            usage->indexedContainers += sizeof(IndexedContainerData) + container->typesCount() * sizeof(IndexedType);
+            for ( int i = 0; i < container->typesCount(); i++ ) {
+                addTypeUsage(container->typeAt(i), seen, usage);
+            }
+        }
+        else if ( MapType::Ptr map = type.cast<MapType>() ) {
+            addTypeUsage(map->keyType(), seen, usage);
+            addTypeUsage(map->contentType(), seen, usage);
+        }
+        else if ( ListType::Ptr list = type.cast<ListType>() ) {
+            addTypeUsage(list->contentType(), seen, usage);
+        }
+        else if ( FunctionType::Ptr function = type.cast<FunctionType>() ) {
+            addTypeUsage(IndexedType(function->returnType()), seen, usage);
+            foreach ( const AbstractType::Ptr& argument, function->arguments() ) {
+                addTypeUsage(IndexedType(argument), seen, usage);
+            }
+        }
+    }
+
+    uint declarationSize(Declaration* declaration)
+    {
+        if ( Python::FunctionDeclaration* function = dynamic_cast<Python::FunctionDeclaration*>(declaration) ) {
+            return sizeof(Python::FunctionDeclarationData)
+                   + function->decoratorsSize() * sizeof(Decorator)
+                   + function->docstringHintsSize() * sizeof(DocstringHint)
+                   + function->defaultParametersSize() * sizeof(IndexedString);
+        }
+        if ( Python::ClassDeclaration* klass = dynamic_cast<Python::ClassDeclaration*>(declaration) ) {
+            return sizeof(Python::ClassDeclarationData)
+                   + klass->decoratorsSize() * sizeof(Decorator)
+                   + klass->baseClassesSize() * sizeof(BaseClassInstance);
+        }
+        return sizeof(DeclarationData);
+    }
+
+    void addContextUsage(DUContext* context, QSet<uint>* seenTypes, MemoryUsage* usage)
+    {
+        usage->contexts += sizeof(DUContextData)
+                           + context->childContexts().size() * sizeof(LocalIndexedDUContext)
+                           + context->localDeclarations().size() * sizeof(LocalIndexedDeclaration)
+                           + context->importedParentContexts().size() * sizeof(DUContext::Import)
+                           + context->importers().size() * sizeof(IndexedDUContext);
+        usage->uses += context->usesCount() * sizeof(Use);
+        foreach ( Declaration* declaration, context->localDeclarations() ) {
+            usage->declarations += declarationSize(declaration);
+            addTypeUsage(declaration->indexedType(), seenTypes, usage);
+        }
+        foreach ( DUContext* child, context->childContexts() ) {
+            addContextUsage(child, seenTypes, usage);
+        }
+    }
+}
+
+MemoryUsage DumpChain::memoryUsage(TopDUContext* top)
+{
+    MemoryUsage usage;
+    if ( ! top ) {
+        return usage;
+    }
+    usage.url = top->url();
+    QSet<uint> seenTypes;
+    addContextUsage(top, &seenTypes, &usage);
+    foreach ( const ProblemPointer& problem, top->problems() ) {
+        usage.problems += sizeof(ProblemData) + problem->description().size() * sizeof(QChar);
+    }
+    return usage;
+}
+
+QList<MemoryUsage> DumpChain::largestDocuments(int count)
+{
+    QList<MemoryUsage> usages;
+    const IndexedString python("python");
+    {
+        DUChainReadLocker lock;
+        foreach ( TopDUContext* top, DUChain::self()->allChains() ) {
+            if ( top->parsingEnvironmentFile() && top->parsingEnvironmentFile()->language() != python ) {
+                continue;
+            }
+            usages.append(memoryUsage(top));
+        }
+    }
+    std::sort(usages.begin(), usages.end(), [](const MemoryUsage& a, const MemoryUsage& b) {
+        return a.total() > b.total();
+    });
+    if ( count > 0 && usages.size() > count ) {
+        usages.erase(usages.begin() + count, usages.end());
+    }
+    return usages;
+}
+
+void DumpChain::printMemoryUsage(QTextStream& out, const QList<MemoryUsage>& usages)
+{
+    auto printRow = [&out](const MemoryUsage& usage, const QString& name) {
+        out << qSetFieldWidth(10) << usage.total() << usage.declarations << usage.contexts << usage.uses
+            << usage.problems << usage.unsureTypes << usage.indexedContainers << usage.hintedTypes
+            << qSetFieldWidth(0) << "  " << name << endl;
+    };
+    out << qSetFieldWidth(10) << "total" << "decls" << "contexts" << "uses" << "problems"
+        << "unsure" << "container" << "hinted" << qSetFieldWidth(0) << "  document" << endl;
+    MemoryUsage sum;
+    foreach ( const MemoryUsage& usage, usages ) {
+        printRow(usage, usage.url.str());
+        sum.declarations += usage.declarations;
+        sum.contexts += usage.contexts;
+        sum.uses += usage.uses;
+        sum.problems += usage.problems;
+        sum.unsureTypes += usage.unsureTypes;
+        sum.indexedContainers += usage.indexedContainers;
+        sum.hintedTypes += usage.hintedTypes;
+    }
+    printRow(sum, QString("(%1 documents)").arg(usages.size()));
+}
 
 DumpChain::DumpChain()
     : indent(0)
@@ -24,6 +24,9 @@
 #define DUMPCHAIN_H
 
 #include <QTextStream>
+#include <QList>
+
+#include <language/duchain/indexedstring.h>
 
 #include "astdefaultvisitor.h"
 #include "pythonduchainexport.h"
@@ -32,6 +35,7 @@
 namespace KDevelop
 {
     class DUContext;
+    class TopDUContext;
 }
 
 namespace Python
@@ -40,6 +44,28 @@ namespace Python
 class ParseSession;
 class PythonEditorIntegrator;
 
+/**
+ * @brief Estimated memory used by the DUChain data of one document, in bytes.
+ *
+ * The sizes are computed from the data classes and the lengths of their appended lists.
+ * Types are stored in a shared repository; they are counted once per document which uses them.
+ */
+struct KDEVPYTHONDUCHAIN_EXPORT MemoryUsage
+{
+    KDevelop::IndexedString url;
+    uint declarations = 0;
+    uint contexts = 0;
+    uint uses = 0;
+    uint problems = 0;
+    uint unsureTypes = 0;
+    uint indexedContainers = 0;
+    uint hintedTypes = 0;
+
+    uint total() const {
+        return declarations + contexts + uses + problems + unsureTypes + indexedContainers + hintedTypes;
+    };
+};
+
 class KDEVPYTHONDUCHAIN_EXPORT DumpChain
 {
 public:
@@ -47,6 +73,23 @@ public:
     virtual ~DumpChain();
     void dump(KDevelop::DUContext* context, bool imported = false);
 
+    /**
+     * @brief Estimate the memory used by @p top and everything in it.
+     * @warning The DUChain must be at least read-locked for this
+     */
+    static MemoryUsage memoryUsage(KDevelop::TopDUContext* top);
+
+    /**
+     * @brief The @p count python documents in the DUChain which use the most memory, largest first.
+     * Pass 0 to get all of them.
+     */
+    static QList<MemoryUsage> largestDocuments(int count);
+
+    /**
+     * @brief Print @p usages as a table with one document per line, followed by the sum of each column.
+     */
+    static void printMemoryUsage(QTextStream& out, const QList<MemoryUsage>& usages);
+
 private:
     int indent;
 };
@@ -0,0 +1,46 @@
+/*****************************************************************************
+ * Copyright (c) 2014 Sven Brauch <svenbrauch@gmail.com>                     *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or             *
+ * modify it under the terms of the GNU General Public License as            *
+ * published by the Free Software Foundation; either version 2 of            *
+ * the License, or (at your option) any later version.                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License for more details.                              *
+ *                                                                           *
+ * You should have received a copy of the GNU General Public License         *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.     *
+ *****************************************************************************
+ */
+
+#include "expressioncache.h"
+
+namespace Python
+{
+
+bool ExpressionCache::lookup(const Ast* node, const KDevelop::DUContext* context, ExpressionCache::Result* result)
+{
+    auto it = m_results.constFind(Key(node, context));
+    if ( it == m_results.constEnd() ) {
+        m_misses++;
+        return false;
+    }
+    m_hits++;
+    *result = *it;
+    return true;
+}
+
+void ExpressionCache::insert(const Ast* node, const KDevelop::DUContext* context, const ExpressionCache::Result& result)
+{
+    m_results.insert(Key(node, context), result);
+}
+
+void ExpressionCache::clear()
+{
+    m_results.clear();
+}
+
+}
@@ -0,0 +1,89 @@
+/*****************************************************************************
+ * Copyright (c) 2014 Sven Brauch <svenbrauch@gmail.com>                     *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or             *
+ * modify it under the terms of the GNU General Public License as            *
+ * published by the Free Software Foundation; either version 2 of            *
+ * the License, or (at your option) any later version.                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License for more details.                              *
+ *                                                                           *
+ * You should have received a copy of the GNU General Public License         *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.     *
+ *****************************************************************************
+ */
+
+#ifndef EXPRESSIONCACHE_H
+#define EXPRESSIONCACHE_H
+
+#include <QHash>
+#include <QPair>
+
+#include <language/duchain/types/abstracttype.h>
+#include <language/duchain/duchainpointer.h>
+
+#include "pythonduchainexport.h"
+
+namespace KDevelop {
+    class DUContext;
+}
+
+namespace Python
+{
+
+class Ast;
+
+/**
+ * @brief Memoizes the results of ExpressionVisitor runs during one parse job.
+ *
+ * Entries are keyed by the AST node which was evaluated and the context it was evaluated in.
+ * The builders own the validity of the stored results: whoever changes declarations or types
+ * which an evaluated expression could depend on must call @ref clear() afterwards.
+ * The hit and miss counters survive clear(), so they describe the whole parse job.
+ */
+class KDEVPYTHONDUCHAIN_EXPORT ExpressionCache
+{
+public:
+    struct Result {
+        KDevelop::AbstractType::Ptr type;
+        KDevelop::DeclarationPointer declaration;
+        bool isAlias;
+        bool isConfident;
+    };
+
+    /**
+     * @brief Look up the result for @p node evaluated in @p context.
+     * @return true if a result was found; it is then stored in @p result.
+     */
+    bool lookup(const Ast* node, const KDevelop::DUContext* context, Result* result);
+
+    /**
+     * @brief Store the result for @p node evaluated in @p context.
+     */
+    void insert(const Ast* node, const KDevelop::DUContext* context, const Result& result);
+
+    /**
+     * @brief Drop all stored results, but keep the statistics.
+     */
+    void clear();
+
+    uint hits() const {
+        return m_hits;
+    };
+    uint misses() const {
+        return m_misses;
+    };
+
+private:
+    typedef QPair<const Ast*, const KDevelop::DUContext*> Key;
+    QHash<Key, Result> m_results;
+    uint m_hits = 0;
+    uint m_misses = 0;
+};
+
+}
+
+#endif // EXPRESSIONCACHE_H
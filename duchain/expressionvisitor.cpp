@@ -49,6 +49,25 @@ namespace Python {
 
 QHash<NameConstantAst::NameConstantTypes, KDevelop::AbstractType::Ptr> ExpressionVisitor::m_defaultTypes;
 
+namespace {
+    // Literals with more elements than this (typically generated lookup tables) only have
+    // a sample of their elements evaluated, and such tuples get a single, merged entry.
+    const int maxLiteralElements = 100;
+    const int literalSampleSize = 20;
+
+    template<typename T>
+    QList<T> sampleElements(const QList<T>& elements) {
+        if ( elements.size() <= maxLiteralElements ) {
+            return elements;
+        }
+        QList<T> sample;
+        for ( int i = 0; i < literalSampleSize; i++ ) {
+            sample << elements.at(i * elements.size() / literalSampleSize);
+        }
+        return sample;
+    }
+}
+
 AbstractType::Ptr ExpressionVisitor::encounterPreprocess(AbstractType::Ptr type)
 {
     return Helper::resolveAliasType(type);
@@ -72,6 +91,7 @@ ExpressionVisitor::ExpressionVisitor(ExpressionVisitor* parent, const DUContext*
     , m_forceGlobalSearching(parent->m_forceGlobalSearching)
     , m_reportUnknownNames(parent->m_reportUnknownNames)
     , m_scanUntilCursor(parent->m_scanUntilCursor)
+    , m_cache(parent->m_cache)
 {
     ENSURE_CHAIN_NOT_LOCKED
     if ( overrideContext ) {
@@ -80,12 +100,59 @@ ExpressionVisitor::ExpressionVisitor(ExpressionVisitor* parent, const DUContext*
     Q_ASSERT(context());
 }
 
+AbstractType::Ptr ExpressionVisitor::integralTypeObject(const QString& typeDescriptor, const DUContext* ctx)
+{
+    if ( auto type = Helper::builtinType(typeDescriptor) ) {
+        return type;
+    }
+    // not a builtin type, or the documentation file is not available yet
+    auto decls = ctx->topContext()->findDeclarations(QualifiedIdentifier(typeDescriptor));
+    auto decl = decls.isEmpty() ? nullptr : dynamic_cast<Declaration*>(decls.first());
+    return decl ? decl->abstractType() : AbstractType::Ptr();
+}
+
+AbstractType::Ptr ExpressionVisitor::booleanType()
+{
+    if ( auto type = Helper::builtinType("bool") ) {
+        return type;
+    }
+    return m_defaultTypes.value(NameConstantAst::True);
+}
+
 void ExpressionVisitor::encounter(AbstractType::Ptr type, DeclarationPointer declaration, bool alias)
 {
     setLastIsAlias(alias);
     DynamicLanguageExpressionVisitor::encounter(type, declaration);
 }
 
+void ExpressionVisitor::visitNode(Ast* node)
+{
+    bool cacheable = m_cache && node && ! m_reportUnknownNames && ! m_scanUntilCursor.isValid();
+    if ( cacheable ) {
+        switch ( node->astType ) {
+            case Ast::NameAstType:
+            case Ast::AttributeAstType:
+            case Ast::CallAstType:
+            case Ast::SubscriptAstType:
+                break;
+            default:
+                cacheable = false;
+        }
+    }
+    if ( ! cacheable ) {
+        return AstDefaultVisitor::visitNode(node);
+    }
+
+    ExpressionCache::Result cached;
+    if ( m_cache->lookup(node, context(), &cached) ) {
+        encounter(cached.type, cached.declaration, cached.isAlias);
+        setConfident(cached.isConfident);
+        return;
+    }
+    AstDefaultVisitor::visitNode(node);
+    m_cache->insert(node, context(), {lastType(), lastDeclaration(), m_isAlias, isConfident()});
+}
+
 void ExpressionVisitor::visitAttribute(AttributeAst* node)
 {
     ExpressionAst* accessingAttributeOf = node->value;
@@ -107,13 +174,13 @@ void ExpressionVisitor::visitAttribute(AttributeAst* node)
     // Like, for A.B.C where B is an instance of foo, when processing C, find all properties of foo which are called C.
     bool haveOneUsefulType = false;
     Declaration* foundDeclaration = nullptr;
+    const IndexedString attribute(node->attribute->value);
     DUChainReadLocker lock;
     foreach ( StructureType::Ptr current, accessingAttributeOfType ) {
         if ( Helper::isUsefulType(current.cast<AbstractType>()) ) {
             haveOneUsefulType = true;
         }
-        foundDeclaration = Helper::accessAttribute(current->declaration(context()->topContext()),
-                                                   node->attribute->value, context());
+        foundDeclaration = Helper::accessAttribute(current, attribute, context()->topContext());
         if ( foundDeclaration ) {
             break;
         }
@@ -222,9 +289,8 @@ void ExpressionVisitor::checkForDecorators(CallAst* node, FunctionDeclaration* f
         return resultingType;
     };
 
-    QHash< QString, std::function<bool(QStringList, QString)> > knownDecoratorHints;
     kDebug() << "Got function declaration with decorators, checking for list content type...";
-    knownDecoratorHints["getsType"] = [&](QStringList /*arguments*/, QString /*currentHint*/) {
+    auto getsType = [&]() {
         if ( node->function->astType != Ast::AttributeAstType ) {
             return false;
         }
@@ -240,7 +306,7 @@ void ExpressionVisitor::checkForDecorators(CallAst* node, FunctionDeclaration* f
         return false;
     };
 
-    knownDecoratorHints["getsList"] = [&](QStringList /*arguments*/, QString currentHint) {
+    auto getsList = [&](DocstringHint::Kind kind) {
         if ( node->function->astType != Ast::AttributeAstType ) {
             return false;
         }
@@ -255,7 +321,7 @@ void ExpressionVisitor::checkForDecorators(CallAst* node, FunctionDeclaration* f
                 return false;
             }
             AbstractType::Ptr contentType;
-            if ( currentHint == "getsList" ) {
+            if ( kind == DocstringHint::GetsList ) {
                 contentType = t->contentType().abstractType();
             }
             else if ( auto map = MapType::Ptr::dynamicCast(t) ) {
@@ -268,9 +334,7 @@ void ExpressionVisitor::checkForDecorators(CallAst* node, FunctionDeclaration* f
         }
         return false;
     };
-    knownDecoratorHints["getListOfKeys"] = knownDecoratorHints["getsList"];
-
-    knownDecoratorHints["enumerate"] = [&](QStringList /*arguments*/, QString /*currentHint*/) {
+    auto enumerate = [&]() {
         if ( node->function->astType != Ast::NameAstType || node->arguments.size() < 1 ) {
             return false;
         }
@@ -285,7 +349,7 @@ void ExpressionVisitor::checkForDecorators(CallAst* node, FunctionDeclaration* f
         return true;
     };
 
-    knownDecoratorHints["getsListOfBoth"] = [&](QStringList /*arguments*/, QString /*currentHint*/) {
+    auto getsListOfBoth = [&]() {
         kDebug() << "Got getsListOfBoth decorator, checking container";
         if ( node->function->astType != Ast::AttributeAstType ) {
             return false;
@@ -303,8 +367,7 @@ void ExpressionVisitor::checkForDecorators(CallAst* node, FunctionDeclaration* f
         return false;
     };
 
-    knownDecoratorHints["returnContentEqualsContentOf"] = [&](QStringList arguments, QString /*currentHint*/) {
-        int argNum = ! arguments.isEmpty() ? arguments.at(0).toInt() : 0;
+    auto returnContentEqualsContentOf = [&](int argNum) {
         kDebug() << "Found argument dependent decorator, checking argument type" << argNum;
         if ( argNum >= node->arguments.length() ) {
             return false;
@@ -333,13 +396,37 @@ void ExpressionVisitor::checkForDecorators(CallAst* node, FunctionDeclaration* f
         return false;
     };
 
-    foreach ( const QString& currentHint, knownDecoratorHints.keys() ) {
-        QStringList arguments;
-        if ( ! Helper::docstringContainsHint(funcDecl, currentHint, &arguments) ) {
-            continue;
-        }
-        // If the hint word appears in the docstring, run the evaluation function.
-        if ( knownDecoratorHints[currentHint](arguments, currentHint) ) {
+    // The hints were parsed from the docstring when the function was declared.
+    QVector<DocstringHint> hints;
+    {
+        DUChainReadLocker lock;
+        for ( uint i = 0; i < funcDecl->docstringHintsSize(); i++ ) {
+            hints.append(funcDecl->docstringHints()[i]);
+        }
+    }
+    foreach ( const DocstringHint& hint, hints ) {
+        bool found = false;
+        switch ( hint.kind() ) {
+            case DocstringHint::GetsType:
+                found = getsType();
+                break;
+            case DocstringHint::GetsList:
+            case DocstringHint::GetListOfKeys:
+                found = getsList(hint.kind());
+                break;
+            case DocstringHint::Enumerate:
+                found = enumerate();
+                break;
+            case DocstringHint::GetsListOfBoth:
+                found = getsListOfBoth();
+                break;
+            case DocstringHint::ReturnContentEqualsContentOf:
+                found = returnContentEqualsContentOf(hint.argument());
+                break;
+            default:
+                break;
+        }
+        if ( found ) {
             // We indeed found something, so we're done.
             return;
         }
@@ -429,7 +516,7 @@ void ExpressionVisitor::visitList(ListAst* node)
     lock.unlock();
     ExpressionVisitor contentVisitor(this);
     if ( type ) {
-        foreach ( ExpressionAst* content, node->elements ) {
+        foreach ( ExpressionAst* content, sampleElements(node->elements) ) {
             contentVisitor.visitNode(content);
             type->addContentType<Python::UnsureType>(contentVisitor.lastType());
         }
@@ -512,6 +599,17 @@ void ExpressionVisitor::visitTuple(TupleAst* node) {
     IndexedContainer::Ptr type = typeObjectForIntegralType<IndexedContainer>("tuple", context());
     if ( type ) {
         lock.unlock();
+        if ( node->elements.size() > maxLiteralElements ) {
+            // Don't store one entry per element for huge tuples, treat them as homogeneous instead.
+            ExpressionVisitor v(this);
+            AbstractType::Ptr merged(new IntegralType(IntegralType::TypeMixed));
+            foreach ( ExpressionAst* expr, sampleElements(node->elements) ) {
+                v.visitNode(expr);
+                merged = Helper::mergeTypes(merged, v.lastType());
+            }
+            type->addEntry(merged);
+            return encounter(AbstractType::Ptr::staticCast(type));
+        }
         foreach ( ExpressionAst* expr, node->elements ) {
             ExpressionVisitor v(this);
             v.visitNode(expr);
@@ -550,7 +648,7 @@ void ExpressionVisitor::visitSet(SetAst* node)
     lock.unlock();
     ExpressionVisitor contentVisitor(this);
     if ( type ) {
-        foreach ( ExpressionAst* content, node->elements ) {
+        foreach ( ExpressionAst* content, sampleElements(node->elements) ) {
             contentVisitor.visitNode(content);
             type->addContentType<Python::UnsureType>(contentVisitor.lastType());
         }
@@ -566,11 +664,11 @@ void ExpressionVisitor::visitDict(DictAst* node)
     ExpressionVisitor contentVisitor(this);
     ExpressionVisitor keyVisitor(this);
     if ( type ) {
-        foreach ( ExpressionAst* content, node->values ) {
+        foreach ( ExpressionAst* content, sampleElements(node->values) ) {
             contentVisitor.visitNode(content);
             type->addContentType<Python::UnsureType>(contentVisitor.lastType());
         }
-        foreach ( ExpressionAst* key, node->keys ) {
+        foreach ( ExpressionAst* key, sampleElements(node->keys) ) {
             keyVisitor.visitNode(key);
             type->addKeyType<Python::UnsureType>(keyVisitor.lastType());
         }
@@ -616,6 +714,9 @@ void ExpressionVisitor::addUnknownName(const QString& name)
 void ExpressionVisitor::visitNameConstant(NameConstantAst* node)
 {
     // handles "True", "False", "None"
+    if ( node->value == NameConstantAst::True || node->value == NameConstantAst::False ) {
+        return encounter(booleanType());
+    }
     auto defId = m_defaultTypes.constFind(node->value);
     if ( defId != m_defaultTypes.constEnd() ) {
         return encounter(*defId);
@@ -653,7 +754,7 @@ void ExpressionVisitor::visitName(Python::NameAst* node)
 void ExpressionVisitor::visitCompare(CompareAst* node)
 {
     Python::AstDefaultVisitor::visitCompare(node);
-    encounter(AbstractType::Ptr(new IntegralType(IntegralType::TypeBoolean)));
+    encounter(booleanType());
 }
 
 AbstractType::Ptr ExpressionVisitor::fromBinaryOperator(AbstractType::Ptr lhs, AbstractType::Ptr rhs, const QString& op) {
@@ -669,8 +770,9 @@ AbstractType::Ptr ExpressionVisitor::fromBinaryOperator(AbstractType::Ptr lhs, A
         }
         auto operatorFunctionType = func->type<FunctionType>();
         DUChainReadLocker lock;
-        auto object_decl = Helper::getDocumentationFileContext()->findDeclarations(QualifiedIdentifier("object"));
-        if ( ! object_decl.isEmpty() && object_decl.first()->internalContext() == func->context() ) {
+        auto objectType = Helper::builtinType("object").cast<StructureType>();
+        auto objectDecl = objectType ? objectType->declaration(context()->topContext()) : nullptr;
+        if ( objectDecl && objectDecl->internalContext() == func->context() ) {
             // if the operator is only declared in object(), do not include its type (which is void).
             return AbstractType::Ptr();
         }
@@ -718,7 +820,7 @@ void ExpressionVisitor::visitBooleanOperation(Python::BooleanOperationAst* node)
         visitNode(expression);
     }
 
-    encounter(AbstractType::Ptr(new IntegralType(IntegralType::TypeBoolean)));
+    encounter(booleanType());
 }
 
 }
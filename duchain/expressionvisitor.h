@@ -37,6 +37,7 @@
 #include "astdefaultvisitor.h"
 #include "pythonduchainexport.h"
 #include "pythoneditorintegrator.h"
+#include "expressioncache.h"
 
 #include "duchain/declarations/classdeclaration.h"
 #include "duchain/declarations/functiondeclaration.h"
@@ -56,6 +57,7 @@ public:
     /// Use this to construct the expression-visitor recursively
     ExpressionVisitor(Python::ExpressionVisitor* parent, const DUContext* overrideContext=nullptr);
 
+    virtual void visitNode(Ast* node);
     virtual void visitBinaryOperation(BinaryOperationAst* node);
     virtual void visitUnaryOperation(UnaryOperationAst* node);
     virtual void visitBooleanOperation(BooleanOperationAst* node);
@@ -100,6 +102,14 @@ public:
         m_reportUnknownNames = true;
     }
 
+    /**
+     * @brief Share results of name, attribute, call and subscript evaluation through @p cache.
+     * Child visitors inherit the cache. Not used when scanning until a cursor or reporting unknown names.
+     */
+    void setCache(ExpressionCache* cache) {
+        m_cache = cache;
+    }
+
     void scanUntil(const CursorInRevision& end) {
         m_scanUntilCursor = end;
     }
@@ -110,14 +120,18 @@ public:
 
     template<typename T>
     static TypePtr<T> typeObjectForIntegralType(const QString& typeDescriptor, const DUContext* ctx) {
-        // TODO: use Helper::documentationFileContext here instead of ctx?
-        auto decls = ctx->topContext()->findDeclarations(QualifiedIdentifier(typeDescriptor));
-        auto decl = decls.isEmpty() ? nullptr : dynamic_cast<Declaration*>(decls.first());
-        auto type = decl ? decl->abstractType() : AbstractType::Ptr();
-        return type.cast<T>();
+        return integralTypeObject(typeDescriptor, ctx).cast<T>();
     }
 
+    /**
+     * @brief Get the type of the builtin class @p typeDescriptor, such as "int" or "list".
+     * Uses the table of builtin types if possible, and searches from @p ctx otherwise.
+     */
+    static AbstractType::Ptr integralTypeObject(const QString& typeDescriptor, const DUContext* ctx);
+
 private:
+    /// The type of True, False and comparisons, from the table of builtin types if possible.
+    static AbstractType::Ptr booleanType();
     AbstractType::Ptr fromBinaryOperator(AbstractType::Ptr lhs, AbstractType::Ptr rhs, const QString& op);
     AbstractType::Ptr encounterPreprocess(AbstractType::Ptr type, bool merge=false);
     void encounter(AbstractType::Ptr type, DeclarationPointer declaration=DeclarationPointer(), bool alias=false);
@@ -138,6 +152,8 @@ private:
     /// used by code completion to detect unknown NameAst elements in expressions
     bool m_reportUnknownNames = false;
     CursorInRevision m_scanUntilCursor = CursorInRevision::invalid();
+    /// results shared with other visitors of the same parse job, may be null
+    ExpressionCache* m_cache = nullptr;
     static QHash<NameConstantAst::NameConstantTypes, KDevelop::AbstractType::Ptr> m_defaultTypes;
     QSet<QString> m_unknownNames;
 };
@@ -24,15 +24,19 @@
 #include <KDebug>
 #include <KStandardDirs>
 #include <QProcess>
+#include <QReadWriteLock>
+#include <QSet>
 
 #include <language/duchain/types/unsuretype.h>
 #include <language/duchain/types/integraltype.h>
 #include <language/duchain/types/containertypes.h>
+#include <language/duchain/types/functiontype.h>
 #include <language/duchain/duchainutils.h>
 #include <language/duchain/duchainlock.h>
 #include <language/duchain/duchain.h>
 #include <language/duchain/classdeclaration.h>
 #include <language/duchain/aliasdeclaration.h>
+#include <language/duchain/parsingenvironment.h>
 #include <language/backgroundparser/backgroundparser.h>
 #include <interfaces/iproject.h>
 #include <interfaces/icore.h>
@@ -59,6 +63,8 @@ QString Helper::documentationFile;
 DUChainPointer<TopDUContext> Helper::documentationFileContext = DUChainPointer<TopDUContext>(0);
 QStringList Helper::correctionFileDirs;
 QString Helper::localCorrectionFileDir;
+const uint Helper::defaultMaxUnsureTypes;
+uint Helper::maxUnsureTypes = Helper::defaultMaxUnsureTypes;
 
 void Helper::scheduleDependency(const IndexedString& dependency, int betterThanPriority)
 {
@@ -112,20 +118,252 @@ Declaration* Helper::accessAttribute(Declaration* accessed, const QString& attri
             return type && type->whichType() == AbstractType::TypeStructure;
         }
     );
+    const IndexedString indexedAttribute(attribute);
     for ( auto type: structureTypes ) {
-        QList<DUContext*> searchContexts = Helper::internalContextsForClass(type, current->topContext());
-        for ( DUContext* c: searchContexts ) {
-            QList< Declaration* > found = c->findDeclarations(KDevelop::Identifier(attribute),
-                                                              CursorInRevision::invalid(),
-                                                              current->topContext(), DUContext::DontSearchInParent);
-            if ( ! found.isEmpty() ) {
-                return found.first();
-            }
+        if ( Declaration* found = Helper::accessAttribute(type, indexedAttribute, current->topContext()) ) {
+            return found;
         }
     }
     return nullptr;
 }
 
+namespace {
+    struct AttributeCacheEntry {
+        IndexedDeclaration declaration;
+        // top context of the class and its modification revision when the entry was created
+        IndexedTopDUContext owner;
+        ModificationRevision revision;
+        // all documents which contain one of the searched contexts
+        QVector<IndexedString> documents;
+    };
+    /// Visibility depends on the document the lookup is made from, so its top context is part of the key.
+    struct AttributeCacheKey {
+        DeclarationId klass;
+        IndexedString attribute;
+        uint current;
+        bool operator==(const AttributeCacheKey& other) const {
+            return klass == other.klass && attribute == other.attribute && current == other.current;
+        };
+    };
+    uint qHash(const AttributeCacheKey& key)
+    {
+        return key.klass.hash() ^ ( key.attribute.index() * 31 ) ^ ( key.current * 101 );
+    }
+
+    QReadWriteLock attributeCacheLock;
+    QHash<AttributeCacheKey, AttributeCacheEntry> attributeCache;
+    /// The keys of the entries which depend on each document, so they can be dropped without a scan
+    QHash<IndexedString, QSet<AttributeCacheKey>> attributeCacheKeysByDocument;
+    // documents currently being parsed, their declarations are not final
+    QSet<IndexedString> documentsInUpdate;
+    const int maxAttributeCacheSize = 50000;
+
+    bool documentsStable(const QVector<IndexedString>& documents)
+    {
+        foreach ( const IndexedString& document, documents ) {
+            if ( documentsInUpdate.contains(document) ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Remove the entry for @p key and its references from the document index; the cache must be write-locked.
+    void removeAttributeCacheEntry(const AttributeCacheKey& key)
+    {
+        auto it = attributeCache.find(key);
+        if ( it == attributeCache.end() ) {
+            return;
+        }
+        foreach ( const IndexedString& document, it->documents ) {
+            auto keys = attributeCacheKeysByDocument.find(document);
+            if ( keys != attributeCacheKeysByDocument.end() ) {
+                keys->remove(key);
+                if ( keys->isEmpty() ) {
+                    attributeCacheKeysByDocument.erase(keys);
+                }
+            }
+        }
+        attributeCache.erase(it);
+    }
+
+    ModificationRevision revisionOf(const TopDUContext* top)
+    {
+        ParsingEnvironmentFilePointer file = top ? top->parsingEnvironmentFile() : ParsingEnvironmentFilePointer();
+        return file ? file->modificationRevision() : ModificationRevision();
+    }
+}
+
+Declaration* Helper::accessAttribute(StructureType::Ptr klassType, const IndexedString& attribute,
+                                     const TopDUContext* current)
+{
+    if ( ! klassType ) {
+        return nullptr;
+    }
+    const AttributeCacheKey key{klassType->declarationId(), attribute, current ? current->ownIndex() : 0};
+    {
+        QReadLocker lock(&attributeCacheLock);
+        auto it = attributeCache.constFind(key);
+        if ( it != attributeCache.constEnd() && documentsStable(it->documents) ) {
+            AttributeCacheEntry entry = *it;
+            lock.unlock();
+            TopDUContext* owner = entry.owner.data();
+            if ( owner && revisionOf(owner) == entry.revision ) {
+                if ( ! entry.declaration.isValid() ) {
+                    return nullptr;
+                }
+                if ( Declaration* declaration = entry.declaration.data() ) {
+                    return declaration;
+                }
+            }
+        }
+    }
+
+    const KDevelop::Identifier identifier(attribute);
+    TopDUContext* top = const_cast<TopDUContext*>(current);
+    Declaration* found = nullptr;
+    AttributeCacheEntry entry;
+    foreach ( DUContext* c, Helper::internalContextsForClass(klassType, top) ) {
+        const IndexedString document = c->topContext()->url();
+        if ( ! entry.documents.contains(document) ) {
+            entry.documents << document;
+        }
+        QList<Declaration*> declarations = c->findDeclarations(identifier, CursorInRevision::invalid(),
+                                                               current, DUContext::DontSearchInParent);
+        if ( ! declarations.isEmpty() ) {
+            found = declarations.first();
+            break;
+        }
+    }
+
+    Declaration* klass = klassType->declaration(top);
+    if ( ! klass ) {
+        return found;
+    }
+    entry.declaration = IndexedDeclaration(found);
+    entry.owner = IndexedTopDUContext(klass->topContext());
+    entry.revision = revisionOf(klass->topContext());
+    if ( ! entry.documents.contains(klass->topContext()->url()) ) {
+        entry.documents << klass->topContext()->url();
+    }
+    QWriteLocker lock(&attributeCacheLock);
+    if ( documentsStable(entry.documents) ) {
+        if ( attributeCache.size() >= maxAttributeCacheSize ) {
+            attributeCache.clear();
+            attributeCacheKeysByDocument.clear();
+        }
+        removeAttributeCacheEntry(key);
+        attributeCache.insert(key, entry);
+        foreach ( const IndexedString& document, entry.documents ) {
+            attributeCacheKeysByDocument[document].insert(key);
+        }
+    }
+    return found;
+}
+
+void Helper::beginDocumentUpdate(const IndexedString& document)
+{
+    QWriteLocker lock(&attributeCacheLock);
+    documentsInUpdate.insert(document);
+}
+
+void Helper::endDocumentUpdate(const IndexedString& document)
+{
+    QWriteLocker lock(&attributeCacheLock);
+    documentsInUpdate.remove(document);
+    foreach ( const AttributeCacheKey& key, attributeCacheKeysByDocument.value(document) ) {
+        removeAttributeCacheEntry(key);
+    }
+}
+
+AbstractType::Ptr Helper::removeStaleHints(AbstractType::Ptr type)
+{
+    if ( HintedType::Ptr hinted = type.cast<HintedType>() ) {
+        if ( ! hinted->isValid(type->indexed()) ) {
+            return AbstractType::Ptr(new IntegralType(IntegralType::TypeMixed));
+        }
+    }
+    else if ( UnsureType::Ptr unsure = type.cast<UnsureType>() ) {
+        QVector<IndexedType> kept;
+        for ( unsigned int i = 0; i < unsure->typesSize(); i++ ) {
+            HintedType::Ptr hinted = unsure->types()[i].abstractType().cast<HintedType>();
+            if ( ! hinted || hinted->isValid(unsure->types()[i]) ) {
+                kept.append(unsure->types()[i]);
+            }
+        }
+        if ( kept.size() == (int) unsure->typesSize() ) {
+            return type;
+        }
+        if ( kept.isEmpty() ) {
+            return AbstractType::Ptr(new IntegralType(IntegralType::TypeMixed));
+        }
+        if ( kept.size() == 1 ) {
+            return kept.first().abstractType();
+        }
+        UnsureType::Ptr result(new UnsureType());
+        result->addTypes(kept, kept.size());
+        return result.cast<AbstractType>();
+    }
+    else if ( IndexedContainer::Ptr indexed = type.cast<IndexedContainer>() ) {
+        IndexedContainer::Ptr edit;
+        for ( int i = 0; i < indexed->typesCount(); i++ ) {
+            AbstractType::Ptr entry = indexed->typeAt(i).abstractType();
+            AbstractType::Ptr cleaned = removeStaleHints(entry);
+            if ( cleaned == entry ) {
+                continue;
+            }
+            if ( ! edit ) {
+                edit = IndexedContainer::Ptr(static_cast<IndexedContainer*>(indexed->clone()));
+            }
+            edit->replaceType(i, cleaned);
+        }
+        return edit ? edit.cast<AbstractType>() : type;
+    }
+    else if ( ListType::Ptr list = type.cast<ListType>() ) {
+        AbstractType::Ptr content = list->contentType().abstractType();
+        if ( ! content ) {
+            return type;
+        }
+        AbstractType::Ptr cleaned = removeStaleHints(content);
+        if ( cleaned == content ) {
+            return type;
+        }
+        ListType::Ptr edit(static_cast<ListType*>(list->clone()));
+        edit->replaceContentType(cleaned);
+        return edit.cast<AbstractType>();
+    }
+    return type;
+}
+
+void Helper::removeStaleHints(const QList<IndexedDeclaration>& declarations)
+{
+    foreach ( const IndexedDeclaration& indexed, declarations ) {
+        Declaration* declaration = indexed.declaration();
+        if ( ! declaration || ! declaration->abstractType() ) {
+            continue;
+        }
+        AbstractType::Ptr type = declaration->abstractType();
+        AbstractType::Ptr cleaned = removeStaleHints(type);
+        if ( cleaned == type ) {
+            continue;
+        }
+        declaration->setAbstractType(cleaned);
+        // parameters: also update the argument in the type of the function
+        DUContext* args = declaration->context();
+        Declaration* function = args ? args->owner() : nullptr;
+        FunctionType::Ptr functionType = function ? function->type<FunctionType>() : FunctionType::Ptr();
+        if ( ! functionType ) {
+            continue;
+        }
+        const int index = args->localDeclarations().indexOf(declaration);
+        if ( index >= 0 && index < functionType->arguments().size() ) {
+            functionType->removeArgument(index);
+            functionType->addArgument(cleaned, index);
+            function->setAbstractType(functionType.cast<AbstractType>());
+        }
+    }
+}
+
 AbstractType::Ptr Helper::resolveAliasType(const AbstractType::Ptr eventualAlias)
 {
     return TypeUtils::resolveAliasType(eventualAlias);
@@ -136,17 +374,18 @@ AbstractType::Ptr Helper::extractTypeHints(AbstractType::Ptr type, TopDUContext*
     UnsureType::Ptr result(new UnsureType());
     unsigned short maxHints = 7;
     if ( HintedType::Ptr hinted = type.cast<HintedType>() ) {
-        if ( hinted->isValid(current) && isUsefulType(hinted.cast<AbstractType>()) ) {
-            result->addType(type->indexed());
+        const IndexedType indexed = type->indexed();
+        if ( hinted->isValid(indexed) && isUsefulType(hinted.cast<AbstractType>()) ) {
+            result->addType(indexed);
         }
     }
     else if ( UnsureType::Ptr unsure = type.cast<UnsureType>() ) {
         int len = unsure->typesSize();
         for ( int i = 0; i < len and i < maxHints; i++ ) {
             if ( HintedType::Ptr hinted = unsure->types()[i].abstractType().cast<HintedType>() ) {
-                if ( hinted->isValid(current) ) {
+                if ( hinted->isValid(unsure->types()[i]) ) {
                     kDebug() << "Adding type hint (multi): " << hinted->toString();
-                    result->addType(hinted->indexed());
+                    result->addType(unsure->types()[i]);
                 }
                 else {
                     kDebug() << "Discarding type hint (multi): " << hinted->toString();
@@ -159,48 +398,58 @@ AbstractType::Ptr Helper::extractTypeHints(AbstractType::Ptr type, TopDUContext*
         }
     }
     else if ( IndexedContainer::Ptr indexed = type.cast<IndexedContainer>() ) {
-        // TODO this is bad because it is slow. Make it faster!
-        // TODO this would really be an important thing, as it will be called quite often.
-        // TODO "how" is simple, just avoid cloning stuff if nothing needs to be changed (i.e. no hints exist).
-        IndexedContainer::Ptr edit = IndexedContainer::Ptr(static_cast<IndexedContainer*>(indexed->clone()));
+        // Only copy the container if one of its entries is a hint which is no longer valid;
+        // a container without (outdated) hints is returned as it is.
+        IndexedContainer::Ptr edit;
         for ( int i = 0; i < indexed->typesCount(); i++ ) {
-            if ( HintedType::Ptr p = indexed->typeAt(i).abstractType().cast<HintedType>() ) {
-                if ( ! p->isValid(current) ) {
-                    edit->replaceType(i, AbstractType::Ptr(new IntegralType(IntegralType::TypeMixed)));
-                }
+            HintedType::Ptr p = indexed->typeAt(i).abstractType().cast<HintedType>();
+            if ( ! p || p->isValid(indexed->typeAt(i)) ) {
+                continue;
             }
+            if ( ! edit ) {
+                edit = IndexedContainer::Ptr(static_cast<IndexedContainer*>(indexed->clone()));
+            }
+            edit->replaceType(i, AbstractType::Ptr(new IntegralType(IntegralType::TypeMixed)));
         }
-        return edit.cast<AbstractType>();
+        return edit ? edit.cast<AbstractType>() : type;
     }
     else if ( auto variable = type.cast<ListType>() ) {
-        auto edit = ListType::Ptr(static_cast<ListType*>(variable->clone()));
-        UnsureType::Ptr newContentType(new UnsureType());
-        AbstractType::Ptr oldContentType = edit->contentType().abstractType();
+        AbstractType::Ptr oldContentType = variable->contentType().abstractType();
+        if ( ! oldContentType ) {
+            return type;
+        }
+        // Check whether the content type contains any hints at all before copying anything.
+        UnsureType::Ptr oldUnsure = oldContentType.cast<UnsureType>();
         bool isHint = false;
-        if ( oldContentType ) {
-            if ( UnsureType::Ptr oldUnsure = oldContentType.cast<UnsureType>() ) {
-                for ( unsigned int i = 0; i < oldUnsure->typesSize(); i++ ) {
-                    if ( HintedType::Ptr hinted = oldUnsure->types()[i].abstractType().cast<HintedType>() ) {
-                        isHint = true;
-                        if ( ! hinted->isValid(current) ) {
-                            continue;
-                        }
-                    }
-                    newContentType->addType(oldUnsure->types()[i]);
+        if ( oldUnsure ) {
+            for ( unsigned int i = 0; i < oldUnsure->typesSize() && ! isHint; i++ ) {
+                if ( oldUnsure->types()[i].abstractType().cast<HintedType>() ) {
+                    isHint = true;
                 }
             }
-            else if ( HintedType::Ptr hinted = oldContentType.cast<HintedType>() ) {
-                isHint = true;
-                if ( hinted->isValid(current) ) {
-                    newContentType->addType(hinted->indexed());
+        }
+        else if ( oldContentType.cast<HintedType>() ) {
+            isHint = true;
+        }
+        if ( ! isHint ) {
+            return result.cast<AbstractType>();
+        }
+        UnsureType::Ptr newContentType(new UnsureType());
+        if ( oldUnsure ) {
+            for ( unsigned int i = 0; i < oldUnsure->typesSize(); i++ ) {
+                HintedType::Ptr hinted = oldUnsure->types()[i].abstractType().cast<HintedType>();
+                if ( hinted && ! hinted->isValid(oldUnsure->types()[i]) ) {
+                    continue;
                 }
+                newContentType->addType(oldUnsure->types()[i]);
             }
-            if ( ! isHint ) {
-                return result.cast<AbstractType>();
-            }
-            edit->replaceContentType(newContentType.cast<AbstractType>());
-//             edit->replaceKeyType(variable->keyType().abstractType()); // TODO re-enable?
         }
+        else if ( oldContentType.cast<HintedType>()->isValid(variable->contentType()) ) {
+            newContentType->addType(variable->contentType());
+        }
+        auto edit = ListType::Ptr(static_cast<ListType*>(variable->clone()));
+        edit->replaceContentType(newContentType.cast<AbstractType>());
+//         edit->replaceKeyType(variable->keyType().abstractType()); // TODO re-enable?
         return edit.cast<AbstractType>();
     }
     return result.cast<AbstractType>();
@@ -242,69 +491,303 @@ Helper::FuncInfo Helper::functionDeclarationForCalledDeclaration(DeclarationPoin
 Declaration* Helper::declarationForName(const QualifiedIdentifier& identifier, const RangeInRevision& nodeRange,
                                         KDevelop::DUChainPointer<const DUContext> context)
 {
-    QList<Declaration*> declarations;
-    QList<Declaration*> localDeclarations;
-    QList<Declaration*> importedLocalDeclarations;
-    {
-        DUChainReadLocker lock(DUChain::lock());
-        if ( context.data() == context->topContext() and nodeRange.isValid() ) {
-            declarations = context->topContext()->findDeclarations(identifier, nodeRange.end);
+    DUChainReadLocker lock(DUChain::lock());
+    const TopDUContext* top = context->topContext();
+    const Identifier& name = identifier.last();
+
+    // Walk up the scopes once, in the order python resolves names: the local scope first,
+    // then the enclosing function scopes, then the module and the builtins (which are imported into it).
+    // Class scopes are only visible from inside the class body itself, not from its methods.
+    for ( const DUContext* current = context.data(); current && current != top; current = current->parentContext() ) {
+        if ( current != context.data() && current->type() == DUContext::Class ) {
+            continue;
         }
-        else {
-            declarations = context->topContext()->findDeclarations(identifier, CursorInRevision::invalid());
+        auto local = current->findLocalDeclarations(name, nodeRange.end, 0,
+                                                    AbstractType::Ptr(0), DUContext::DontResolveAliases);
+        if ( ! local.isEmpty() ) {
+            return local.last();
+        }
+        // for example the arguments context, which is imported by the function body
+        foreach ( const DUContext::Import& import, current->importedParentContexts() ) {
+            DUContext* imported = import.context(top);
+            if ( ! imported ) {
+                continue;
+            }
+            auto found = imported->findDeclarations(name, CursorInRevision::invalid(), top, DUContext::DontSearchInParent);
+            if ( ! found.isEmpty() ) {
+                return found.last();
+            }
         }
-        localDeclarations = context->findLocalDeclarations(identifier.last(), nodeRange.end, 0,
-                                                           AbstractType::Ptr(0), DUContext::DontResolveAliases);
-        importedLocalDeclarations = context->findDeclarations(identifier.last(), nodeRange.end);
     }
-    Declaration* declaration = 0;
-    if ( localDeclarations.length() ) {
-        declaration = localDeclarations.last();
+
+    // Names on module level can only be used after they were declared when used on module level;
+    // functions are executed later, so they can use everything from the module.
+    if ( context.data() == top ) {
+        auto local = top->findLocalDeclarations(name, nodeRange.end, 0,
+                                                AbstractType::Ptr(0), DUContext::DontResolveAliases);
+        if ( ! local.isEmpty() ) {
+            return local.last();
+        }
+    }
+    const bool usePosition = context.data() == top && nodeRange.isValid();
+    auto global = top->findDeclarations(identifier, usePosition ? nodeRange.end : CursorInRevision::invalid());
+    return global.isEmpty() ? nullptr : global.last();
+}
+
+namespace {
+    /// The bases of a class are resolved from a document, so the order is cached per resolving document.
+    struct MroKey {
+        DeclarationId klass;
+        int flags;
+        uint top;
+        bool operator==(const MroKey& other) const {
+            return klass == other.klass && flags == other.flags && top == other.top;
+        };
+    };
+    uint qHash(const MroKey& key)
+    {
+        return key.klass.hash() ^ ( key.top * 31 ) ^ key.flags;
     }
-    else if ( importedLocalDeclarations.length() ) {
-        // don't use declarations from class decls, they must be referenced through "self.<foo>"
-        do {
-            declaration = importedLocalDeclarations.last();
-            importedLocalDeclarations.pop_back();
-            if ( not declaration or declaration->context()->type() == DUContext::Class ) {
-                declaration = 0;
+
+    QReadWriteLock mroCacheLock;
+    QHash<MroKey, QList<DeclarationId>> mroCache;
+    /// The cache entries in whose order a class appears, i.e. the ones of the class and of its subclasses
+    QHash<DeclarationId, QSet<MroKey>> mroDependents;
+    // don't let the cache grow without limit during long sessions
+    const int maxMroCacheSize = 20000;
+
+    /// @p complete is set to false if a part of the hierarchy could not be followed
+    QList<DeclarationId> linearize(StructureType::Ptr klassType, TopDUContext* context,
+                                   Helper::ContextSearchFlags flags, QList<DeclarationId>& visiting, bool& complete)
+    {
+        const DeclarationId self = klassType->declarationId();
+        QList<DeclarationId> result{self};
+        // guard against cyclic and absurdly deep hierarchies
+        if ( visiting.contains(self) || visiting.size() >= 10 ) {
+            complete = false;
+            return result;
+        }
+        ClassDeclaration* klass = dynamic_cast<ClassDeclaration*>(
+            Helper::resolveAliasDeclaration(klassType->declaration(context))
+        );
+        if ( ! klass ) {
+            complete = false;
+            return result;
+        }
+
+        visiting.append(self);
+        QList<QList<DeclarationId>> sequences;
+        QList<DeclarationId> bases;
+        FOREACH_FUNCTION ( const BaseClassInstance& base, klass->baseClasses ) {
+            if ( flags == Helper::PublicOnly and base.access == KDevelop::Declaration::Private ) {
+                continue;
             }
-            if ( importedLocalDeclarations.isEmpty() ) {
-                break;
+            StructureType::Ptr baseClassType = base.baseClass.type<StructureType>();
+            if ( ! baseClassType ) {
+                continue;
             }
-        } while ( ! importedLocalDeclarations.isEmpty() );
-    }
+            bases << baseClassType->declarationId();
+            sequences << linearize(baseClassType, context, flags, visiting, complete);
+        }
+        visiting.removeLast();
+        sequences << bases;
 
-    if ( !declaration && declarations.length() ) {
-        declaration = declarations.last();
+        // C3 merge: repeatedly take the first head which does not appear in the tail of any sequence
+        forever {
+            sequences.removeAll(QList<DeclarationId>());
+            if ( sequences.isEmpty() ) {
+                break;
+            }
+            const DeclarationId* candidate = nullptr;
+            foreach ( const QList<DeclarationId>& sequence, sequences ) {
+                const DeclarationId& head = sequence.first();
+                bool inTail = false;
+                foreach ( const QList<DeclarationId>& other, sequences ) {
+                    if ( other.indexOf(head) > 0 ) {
+                        inTail = true;
+                        break;
+                    }
+                }
+                if ( ! inTail ) {
+                    candidate = &head;
+                    break;
+                }
+            }
+            if ( ! candidate ) {
+                // inconsistent hierarchy, python would refuse it; just append what's left in order
+                foreach ( const QList<DeclarationId>& sequence, sequences ) {
+                    foreach ( const DeclarationId& id, sequence ) {
+                        if ( ! result.contains(id) ) {
+                            result << id;
+                        }
+                    }
+                }
+                break;
+            }
+            const DeclarationId next = *candidate;
+            result << next;
+            for ( QList<DeclarationId>& sequence: sequences ) {
+                if ( sequence.first() == next ) {
+                    sequence.removeFirst();
+                }
+            }
+        }
+        return result;
     }
-    return declaration;
 }
 
-QList< DUContext* > Helper::internalContextsForClass(StructureType::Ptr klassType, TopDUContext* context, ContextSearchFlags flags, int depth)
+QList< DUContext* > Helper::internalContextsForClass(StructureType::Ptr klassType, TopDUContext* context, ContextSearchFlags flags)
 {
     QList<DUContext*> searchContexts;
     if ( ! klassType ) {
         return searchContexts;
     }
+    // container types with different contents are still the same class, so key by declaration
+    const MroKey key{klassType->declarationId(), flags, context ? context->ownIndex() : 0};
+    QList<DeclarationId> mro;
+    bool cached = false;
+    {
+        QReadLocker lock(&mroCacheLock);
+        auto it = mroCache.constFind(key);
+        if ( it != mroCache.constEnd() ) {
+            mro = *it;
+            cached = true;
+        }
+    }
+    if ( ! cached ) {
+        QList<DeclarationId> visiting;
+        bool complete = true;
+        mro = linearize(klassType, context, flags, visiting, complete);
+        // a base which can't be found yet might be declared later on
+        if ( complete && context ) {
+            QWriteLocker lock(&mroCacheLock);
+            if ( mroCache.size() >= maxMroCacheSize ) {
+                mroCache.clear();
+                mroDependents.clear();
+            }
+            mroCache.insert(key, mro);
+            foreach ( const DeclarationId& id, mro ) {
+                mroDependents[id].insert(key);
+            }
+        }
+    }
+
+    // the first entry is the class itself; its type might carry more information than the declaration
     if ( auto c = klassType->internalContext(context) ) {
         searchContexts << c;
     }
-    Declaration* decl = Helper::resolveAliasDeclaration(klassType->declaration(context));
-    ClassDeclaration* klass = dynamic_cast<ClassDeclaration*>(decl);
-    if ( klass ) {
-        FOREACH_FUNCTION ( const BaseClassInstance& base, klass->baseClasses ) {
-            if ( flags == PublicOnly and base.access == KDevelop::Declaration::Private ) {
+    for ( int i = 1; i < mro.size(); i++ ) {
+        Declaration* decl = mro.at(i).getDeclaration(context);
+        if ( decl && decl->internalContext() ) {
+            searchContexts << decl->internalContext();
+        }
+    }
+    return searchContexts;
+}
+
+namespace {
+    /// The classes declared at the top level of one document, by the index of the type of each of their bases
+    struct SubclassTable {
+        ModificationRevision revision;
+        QHash<uint, QVector<IndexedDeclaration>> subclasses;
+    };
+    QReadWriteLock subclassTablesLock;
+    // by index of the top context
+    QHash<uint, SubclassTable> subclassTables;
+
+    SubclassTable subclassTable(TopDUContext* top)
+    {
+        ParsingEnvironmentFilePointer file = top->parsingEnvironmentFile();
+        const ModificationRevision revision = file ? file->modificationRevision() : ModificationRevision();
+        {
+            QReadLocker lock(&subclassTablesLock);
+            auto it = subclassTables.constFind(top->ownIndex());
+            if ( it != subclassTables.constEnd() && it->revision == revision ) {
+                return *it;
+            }
+        }
+        SubclassTable table;
+        table.revision = revision;
+        foreach ( Declaration* declaration, top->localDeclarations() ) {
+            ClassDeclaration* klass = dynamic_cast<ClassDeclaration*>(declaration);
+            if ( ! klass ) {
                 continue;
             }
-            StructureType::Ptr baseClassType = base.baseClass.type<StructureType>();
-            // recursive call, because the base class will have more base classes eventually
-            if ( depth < 10 ) {
-                searchContexts.append(Helper::internalContextsForClass(baseClassType, context, flags, depth + 1));
+            FOREACH_FUNCTION ( const BaseClassInstance& base, klass->baseClasses ) {
+                table.subclasses[base.baseClass.index()].append(IndexedDeclaration(klass));
             }
         }
+        QWriteLocker lock(&subclassTablesLock);
+        subclassTables.insert(top->ownIndex(), table);
+        return table;
     }
-    return searchContexts;
+}
+
+QList<Declaration*> Helper::subclassesOf(Declaration* base, TopDUContext* context)
+{
+    QList<Declaration*> result;
+    if ( ! base || ! context ) {
+        return result;
+    }
+    // the documents visible from the context, including itself
+    QList<TopDUContext*> documents{context};
+    QSet<TopDUContext*> seenDocuments{context};
+    for ( int i = 0; i < documents.size(); i++ ) {
+        foreach ( const DUContext::Import& import, documents.at(i)->importedParentContexts() ) {
+            TopDUContext* imported = dynamic_cast<TopDUContext*>(import.context(context));
+            if ( imported && ! seenDocuments.contains(imported) ) {
+                seenDocuments.insert(imported);
+                documents << imported;
+            }
+        }
+    }
+    QVector<SubclassTable> tables;
+    tables.reserve(documents.size());
+    foreach ( TopDUContext* document, documents ) {
+        tables << subclassTable(document);
+    }
+
+    QList<uint> pending{base->indexedType().index()};
+    QSet<uint> seenTypes{pending.first()};
+    while ( ! pending.isEmpty() ) {
+        const uint type = pending.takeFirst();
+        foreach ( const SubclassTable& table, tables ) {
+            auto it = table.subclasses.constFind(type);
+            if ( it == table.subclasses.constEnd() ) {
+                continue;
+            }
+            foreach ( const IndexedDeclaration& subclass, *it ) {
+                Declaration* declaration = subclass.declaration();
+                if ( ! declaration || seenTypes.contains(declaration->indexedType().index()) ) {
+                    continue;
+                }
+                seenTypes.insert(declaration->indexedType().index());
+                pending << declaration->indexedType().index();
+                result << declaration;
+            }
+        }
+    }
+    return result;
+}
+
+void Helper::invalidateClassHierarchy(Declaration* klass)
+{
+    {
+        QWriteLocker lock(&mroCacheLock);
+        foreach ( const MroKey& key, mroDependents.take(klass->id()) ) {
+            foreach ( const DeclarationId& id, mroCache.take(key) ) {
+                auto dependents = mroDependents.find(id);
+                if ( dependents != mroDependents.end() ) {
+                    dependents->remove(key);
+                    if ( dependents->isEmpty() ) {
+                        mroDependents.erase(dependents);
+                    }
+                }
+            }
+        }
+    }
+    QWriteLocker lock(&subclassTablesLock);
+    subclassTables.remove(klass->topContext()->ownIndex());
 }
 
 Declaration* Helper::resolveAliasDeclaration(Declaration* decl)
@@ -347,6 +830,69 @@ ReferencedTopDUContext Helper::getDocumentationFileContext()
     return ReferencedTopDUContext(0); // c++...
 }
 
+namespace {
+    QReadWriteLock builtinTypesLock;
+    QHash<QString, IndexedType> builtinTypes;
+    // the context the table was built from; null if the table needs to be built
+    const TopDUContext* builtinTypesContext = nullptr;
+    // incremented on invalidation, so a table computed concurrently is not stored
+    uint builtinTypesGeneration = 0;
+}
+
+AbstractType::Ptr Helper::builtinType(const QString& name)
+{
+    // names which are declared as classes in the documentation file
+    static const QStringList builtinTypeNames{
+        "int", "float", "complex", "str", "bytes", "list", "tuple", "dict", "set", "object"
+    };
+
+    // avoid the reference counting of getDocumentationFileContext() once the context is known
+    TopDUContext* docContext = Helper::documentationFileContext.data();
+    if ( ! docContext ) {
+        docContext = Helper::getDocumentationFileContext().data();
+    }
+    if ( ! docContext ) {
+        return AbstractType::Ptr();
+    }
+    uint generation = 0;
+    {
+        QReadLocker lock(&builtinTypesLock);
+        if ( builtinTypesContext == docContext ) {
+            return builtinTypes.value(name).abstractType();
+        }
+        generation = builtinTypesGeneration;
+    }
+
+    // Don't hold the table lock while the duchain is locked, another thread might
+    // be waiting for the table while it holds the duchain write lock.
+    QHash<QString, IndexedType> types;
+    {
+        DUChainReadLocker lock;
+        foreach ( const QString& typeName, builtinTypeNames ) {
+            auto decls = docContext->findLocalDeclarations(KDevelop::Identifier(typeName));
+            if ( ! decls.isEmpty() && decls.first()->abstractType() ) {
+                types.insert(typeName, decls.first()->indexedType());
+            }
+        }
+    }
+    // bool() is a function in the documentation file, booleans are integral types
+    types.insert("bool", AbstractType::Ptr(new IntegralType(IntegralType::TypeBoolean))->indexed());
+    QWriteLocker lock(&builtinTypesLock);
+    if ( generation == builtinTypesGeneration ) {
+        builtinTypes = types;
+        builtinTypesContext = docContext;
+    }
+    return types.value(name).abstractType();
+}
+
+void Helper::invalidateBuiltinTypes()
+{
+    QWriteLocker lock(&builtinTypesLock);
+    builtinTypesContext = nullptr;
+    builtinTypes.clear();
+    builtinTypesGeneration++;
+}
+
 KUrl Helper::getCorrectionFile(KUrl document)
 {
     if ( Helper::correctionFileDirs.isEmpty() ) {
@@ -480,11 +1026,78 @@ AbstractType::Ptr Helper::contentOfIterable(const AbstractType::Ptr iterable)
     return unsure;
 }
 
+namespace {
+    // Widening gives an unsure type with object as its only member, which tells it apart
+    // from an object() the code created; merging never produces other unsure types of size 1.
+    bool isWidenedType(const AbstractType::Ptr& type)
+    {
+        auto unsure = UnsureType::Ptr::dynamicCast(type);
+        if ( ! unsure || unsure->typesSize() != 1 ) {
+            return false;
+        }
+        AbstractType::Ptr object = Helper::builtinType("object");
+        return object && unsure->types()[0] == object->indexed();
+    }
+}
+
 AbstractType::Ptr Helper::mergeTypes(AbstractType::Ptr type, const AbstractType::Ptr newType)
 {
+    // Same semantics as TypeUtils::mergeTypes, but with a bounded number of members.
+    // Once a type was widened to object, merging more types into it can't make it more precise.
+    if ( isWidenedType(type) ) {
+        return type;
+    }
+    if ( isWidenedType(newType) ) {
+        return newType;
+    }
+    UnsureType::Ptr unsure = UnsureType::Ptr::dynamicCast(type);
+    UnsureType::Ptr newUnsure = UnsureType::Ptr::dynamicCast(newType);
     UnsureType::Ptr ret;
-    ret.count();
-    return TypeUtils::mergeTypes<Python::UnsureType>(type, newType);
+    QVector<IndexedType> added;
+    if ( unsure ) {
+        // like in TypeUtils, an unsure type passed as the first argument is extended in-place
+        ret = unsure;
+        if ( newUnsure ) {
+            for ( unsigned int i = 0; i < newUnsure->typesSize(); i++ ) {
+                added.append(newUnsure->types()[i]);
+            }
+        }
+        else if ( isUsefulType(newType) ) {
+            added.append(newType->indexed());
+        }
+    }
+    else if ( newUnsure ) {
+        ret = UnsureType::Ptr(static_cast<UnsureType*>(newUnsure->clone()));
+        if ( isUsefulType(type) ) {
+            added.append(type->indexed());
+        }
+    }
+    else {
+        ret = UnsureType::Ptr(new UnsureType());
+        if ( isUsefulType(type) ) {
+            added.append(type->indexed());
+        }
+        if ( isUsefulType(newType) ) {
+            added.append(newType->indexed());
+        }
+        if ( added.isEmpty() ) {
+            return AbstractType::Ptr(new IntegralType(IntegralType::TypeMixed));
+        }
+    }
+
+    if ( ! ret->addTypes(added, maxUnsureTypes) ) {
+        // Too many possibilities to be useful; everything is an object, so widen to that.
+        if ( AbstractType::Ptr object = builtinType("object") ) {
+            UnsureType::Ptr widened(new UnsureType());
+            widened->addType(object->indexed());
+            return widened.cast<AbstractType>();
+        }
+        return AbstractType::Ptr(new IntegralType(IntegralType::TypeMixed));
+    }
+    if ( ret->typesSize() == 1 ) {
+        return ret->types()[0].abstractType();
+    }
+    return ret.cast<AbstractType>();
 }
 
 }
@@ -32,6 +32,7 @@
 #include <language/editor/simplerange.h>
 #include <language/duchain/topducontext.h>
 #include <language/duchain/types/structuretype.h>
+#include <language/duchain/indexeddeclaration.h>
 #include <language/duchain/functiondeclaration.h>
 #include <duchain/declarations/decorator.h>
 
@@ -52,6 +53,12 @@ namespace Python {
 
 class KDEVPYTHONDUCHAIN_EXPORT Helper {
 public:
+    enum {
+        /// Set on the top contexts whose function declarations store their docstring hints, see DocstringHint.
+        /// Contexts stored by earlier versions don't have it, and are parsed again.
+        StoresDocstringHints = (KDevelop::TopDUContext::LastFeature << 3)
+    };
+
     /** get search paths for python files **/
     static QList<KUrl> getSearchPaths(KUrl workingOnDocument);
     static QStringList dataDirs;
@@ -64,6 +71,20 @@ public:
     static QString getDocumentationFile();
     static ReferencedTopDUContext getDocumentationFileContext();
 
+    /**
+     * @brief Get a fresh copy of the type of the builtin class @p name, such as "int" or "list".
+     *
+     * The types are looked up in the documentation file context only once and kept in a table,
+     * which is rebuilt when that context changes or @ref invalidateBuiltinTypes is called.
+     * @return the type, or a null pointer if @p name is not a builtin type or was not found
+     */
+    static AbstractType::Ptr builtinType(const QString& name);
+
+    /**
+     * @brief Discard the table of builtin types, call this when the documentation file was parsed again.
+     */
+    static void invalidateBuiltinTypes();
+
     static KUrl getCorrectionFile(KUrl document);
     static KUrl getLocalCorrectionFile(KUrl document);
 
@@ -71,8 +92,53 @@ public:
 
     static AbstractType::Ptr extractTypeHints(AbstractType::Ptr type, TopDUContext* current);
 
+    /**
+     * @brief Remove the hints which are no longer valid from @p type.
+     * @return @p type itself if it does not contain any stale hints, a cleaned-up copy otherwise
+     */
+    static AbstractType::Ptr removeStaleHints(AbstractType::Ptr type);
+
+    /**
+     * @brief Remove the stale hints from the types of @p declarations, and from the function types they belong to.
+     * @warning The DUChain must be write-locked.
+     */
+    static void removeStaleHints(const QList<IndexedDeclaration>& declarations);
+
     static Declaration* accessAttribute(Declaration* accessed, const QString& attribute, const DUContext* current);
 
+    /**
+     * @brief Find the declaration of @p attribute in the class @p klassType or its base classes.
+     *
+     * Results are cached per (class, attribute, @p current). An entry is valid as long as the modification revision
+     * of the class' top context is unchanged and none of the searched documents was parsed again.
+     * DUChain must be read locked.
+     */
+    static Declaration* accessAttribute(StructureType::Ptr klassType, const IndexedString& attribute,
+                                        const TopDUContext* current);
+
+    /**
+     * @brief Tell the caches that the semantic information of @p document is being rebuilt.
+     * Cached results depending on that document are not used until @ref endDocumentUpdate is called.
+     */
+    static void beginDocumentUpdate(const IndexedString& document);
+
+    /**
+     * @brief Tell the caches that the semantic information of @p document is final again.
+     * Drops all cached results depending on that document.
+     */
+    static void endDocumentUpdate(const IndexedString& document);
+
+    /// Calls beginDocumentUpdate() on construction and endDocumentUpdate() on destruction.
+    struct DocumentUpdate {
+        DocumentUpdate(const IndexedString& document) : m_document(document) {
+            Helper::beginDocumentUpdate(m_document);
+        };
+        ~DocumentUpdate() {
+            Helper::endDocumentUpdate(m_document);
+        };
+        IndexedString m_document;
+    };
+
     static AbstractType::Ptr resolveAliasType(const AbstractType::Ptr eventualAlias);
 
     /**
@@ -159,9 +225,19 @@ public:
 
     /**
      * @copydoc TypeUtils::mergeTypes
+     *
+     * If the resulting unsure type would have more than @ref maxUnsureTypes members,
+     * it is widened to "object" instead (or mixed, if the builtins are not available).
+     * Merging anything with a widened type gives the widened type again, while a plain
+     * "object" the code created is merged like any other type.
      */
     static AbstractType::Ptr mergeTypes(AbstractType::Ptr type, const AbstractType::Ptr newType);
 
+    /// The maximum number of types an unsure type created by mergeTypes() can consist of.
+    /// Set from the "maxUnsureTypes" entry of the "parsing" group in kdevpythonsupportrc.
+    static uint maxUnsureTypes;
+    static const uint defaultMaxUnsureTypes = 16;
+
     /**
      * @brief Like mergeTypes(), but merges a list of types into a newly allocated type.
      * Returns mixed if the list is empty.
@@ -189,12 +265,32 @@ public:
     /**
     * @brief Find all internal contexts for this class and its base classes recursively
     *
+    * The contexts are returned in python's method resolution order (C3 linearization), without duplicates.
+    * The order is cached per class and document it is resolved from, until @ref invalidateClassHierarchy
+    * is called for the class or one of its bases. Orders with bases which could not be resolved are not cached.
+    *
     * @param klass Type object for the class to search contexts
     * @param context TopContext for finding the declarations for types
     * @return list of contexts which were found
     **/
     static QList<DUContext*> internalContextsForClass(KDevelop::StructureType::Ptr klassType,
-                                                      TopDUContext* context, ContextSearchFlags flags = NoFlags, int depth = 0);
+                                                      TopDUContext* context, ContextSearchFlags flags = NoFlags);
+
+    /**
+     * @brief Find all classes visible from @p context which inherit from @p base, directly or indirectly.
+     *
+     * Only classes on the top level of their document are found. The classes are looked up in
+     * a table of subclasses per document, which is rebuilt when the document changes.
+     * @warning The DUChain must be at least read-locked for this
+     */
+    static QList<Declaration*> subclassesOf(Declaration* base, TopDUContext* context);
+
+    /**
+     * @brief Call this when the bases of @p klass changed.
+     * Discards the cached method resolution orders of @p klass and its subclasses,
+     * and the subclass table of the document of @p klass.
+     */
+    static void invalidateClassHierarchy(Declaration* klass);
     /**
       * @brief Resolve the given declaration if it is an alias declaration.
       *
@@ -204,6 +300,13 @@ public:
       **/
     static Declaration* resolveAliasDeclaration(Declaration* decl);
 
+    /**
+     * @brief Find the declaration a name used at @p nodeRange in @p context refers to.
+     *
+     * Follows python's scoping rules: local scope, enclosing functions, module, builtins.
+     * Class scopes are skipped unless @p context is the class body itself.
+     * The contexts are walked only once, from @p context up to the top context.
+     */
     static Declaration* declarationForName(const QualifiedIdentifier& identifier, const RangeInRevision& nodeRange,
                                            DUChainPointer<const DUContext> context);
 };
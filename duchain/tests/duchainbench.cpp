@@ -28,12 +28,17 @@
 #include <tests/autotestshell.h>
 #include <tests/testcore.h>
 #include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
 #include <QtTest/QtTest>
+#include <QElapsedTimer>
 #include <KStandardDirs>
 #include <language/backgroundparser/backgroundparser.h>
 #include <interfaces/ilanguagecontroller.h>
 
 #include "parsesession.h"
+#include "astdefaultvisitor.h"
+#include "helpers.h"
+#include "declarationbuilder.h"
 
 QTEST_MAIN(DUChainBench)
 
@@ -115,6 +120,7 @@ void DUChainBench::benchSimpleStatements_data()
     QTest::newRow("test_nondistinct_assignment_looped") << repeat_distinct(QString("a=%X\n"), 200);
     QTest::newRow("test_distinct_assignment_repeated") << repeat_distinct(QString("a%X=3\n"), 200);
     QTest::newRow("test_distinct_assignment_looped") << repeat_distinct(QString("a%X=%X\n"), 200);
+    QTest::newRow("test_reassignment_many_types") << repeat_distinct(QString("class C%X: pass\na = C%X()\n"), 200);
     // test function
     QTest::newRow("test_bare_function") << repeat_distinct(QString("def main%X():\n    pass\n"), 100);
     QTest::newRow("test_return_function") << repeat_distinct(QString("def main%X():\n    return %X\n"), 100);
@@ -127,6 +133,16 @@ void DUChainBench::benchSimpleStatements_data()
     QTest::newRow("test_for_loop") << repeat_distinct(QString("for i in range(20):\n    pass\n"), 100);
     QTest::newRow("test_for_loop_enum") << repeat_distinct(QString("for key, value in enumerate({1:2, 7:3}):\n    pass\n"), 200);
     QTest::newRow("test_for_loop_list") << repeat_distinct(QString("for key, value in [(3, 5), (7, 9)]:\n    pass\n"), 200);
+    // test long attribute chains; the parse job prints the expression cache statistics
+    QTest::newRow("test_attribute_chain") << repeat_distinct(QString("class C%X:\n    def m(self):\n        return self\n"
+                                                                     "c%X = C%X()\nd%X = c%X.m().m().m().m().m().m().m().m()\n"), 100);
+    // test huge literals, as found in generated lookup tables
+    QTest::newRow("test_huge_tuple") << "t = (" + repeat_distinct(QString("%X, "), 20000) + ")\n";
+    QTest::newRow("test_huge_dict") << "d = {" + repeat_distinct(QString("%X: 'x%X', "), 20000) + "}\n";
+    // test calls which create type hints for the parameters of the called functions
+    QTest::newRow("test_argument_hints") << repeat_distinct(QString("def func%X(a, b, *args):\n    return a\n"
+                                                                    "func%X(1, [1, 2], 3, 'x')\nfunc%X('a', [(1, 2)], (3, 4))\n"
+                                                                    "func%X(3.5, ['y'], *[1, 2])\n"), 100);
 }
 
 void DUChainBench::benchSimpleStatements()
@@ -135,4 +151,69 @@ void DUChainBench::benchSimpleStatements()
     QBENCHMARK {
         parse(code);
     }
-}
\ No newline at end of file
+}
+
+class NameCollector : public AstDefaultVisitor {
+public:
+    virtual void visitName(NameAst* node) {
+        names << node;
+    };
+    QList<NameAst*> names;
+};
+
+void DUChainBench::benchDeclarationForName()
+{
+    QString code = repeat_distinct(QString("class C%X:\n    attr = %X\n    def method(self, arg):\n"
+                                           "        local = arg + attr_%X\n        return local + global_%X\n"
+                                           "attr_%X = %X\nglobal_%X = C%X().method(attr_%X)\n"), 300);
+    ReferencedTopDUContext top = parse(code);
+    QVERIFY(top);
+
+    NameCollector collector;
+    collector.visitNode(m_ast.data());
+    QList<QPair<NameAst*, DUContext*>> lookups;
+    {
+        DUChainReadLocker lock;
+        foreach ( NameAst* node, collector.names ) {
+            DUContext* ctx = top->findContextAt(CursorInRevision(node->startLine, node->startCol));
+            lookups << qMakePair(node, ctx ? ctx : top.data());
+        }
+    }
+
+    int found = 0;
+    qint64 performed = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        found = 0;
+        foreach ( const auto& lookup, lookups ) {
+            NameAst* node = lookup.first;
+            RangeInRevision range(0, 0, node->endLine, node->endCol);
+            found += Helper::declarationForName(QualifiedIdentifier(node->identifier->value), range,
+                                                DUChainPointer<const DUContext>(lookup.second)) != 0;
+        }
+        performed += lookups.size();
+    }
+    QVERIFY(found > 0);
+    qDebug() << lookups.size() << "names," << found << "resolved,"
+             << performed * 1000 / qMax<qint64>(timer.elapsed(), 1) << "lookups/sec";
+}
+
+void DUChainBench::benchArgumentHintLocks()
+{
+    QString code = repeat_distinct(QString("def func%X(a, b, *args):\n    return a\n"
+                                           "func%X(1, [1, 2], 3, 'x')\nfunc%X('a', [(1, 2)], (3, 4))\n"
+                                           "func%X(3.5, ['y'], *[1, 2])\n"), 100);
+    DeclarationBuilder::HintStatistics statistics = { 0, 0 };
+    QBENCHMARK {
+        DeclarationBuilder::resetHintStatistics();
+        parse(code);
+        statistics = DeclarationBuilder::hintStatistics();
+    }
+    // Storing each argument hint right at its call site takes one write lock per hint;
+    // collecting them and storing them at the end of each pass takes one per pass.
+    QVERIFY(statistics.argumentHints > 0);
+    QVERIFY(statistics.writeLocks < statistics.argumentHints);
+    qDebug() << statistics.argumentHints << "argument hints (write locks when stored per call),"
+             << statistics.writeLocks << "write locks taken";
+}
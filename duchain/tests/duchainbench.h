@@ -52,6 +52,8 @@ public:
 private slots:
     void benchSimpleStatements();
     void benchSimpleStatements_data();
+    void benchDeclarationForName();
+    void benchArgumentHintLocks();
 
 private:
     QList<KDevelop::TestFile*> createdFiles;
@@ -37,6 +37,7 @@
 #include <language/duchain/types/functiontype.h>
 #include <language/duchain/types/containertypes.h>
 #include <language/duchain/aliasdeclaration.h>
+#include <language/duchain/duchainutils.h>
 #include <language/backgroundparser/backgroundparser.h>
 #include <language/interfaces/iastcontainer.h>
 #include <interfaces/ilanguagecontroller.h>
@@ -50,6 +51,8 @@
 #include "expressionvisitor.h"
 #include "contextbuilder.h"
 #include "astbuilder.h"
+#include "dumpchain.h"
+#include "contextrangeindex.h"
 
 #include "duchain/helpers.h"
 
@@ -747,6 +750,36 @@ void PyDUChainTest::testTypes()
     QCOMPARE(visitor->found, true);
 }
 
+void PyDUChainTest::testBuiltinTypes()
+{
+    QFETCH(QString, code);
+    QFETCH(QString, typeName);
+
+    ReferencedTopDUContext ctx = parse(code);
+    QVERIFY(ctx);
+
+    AbstractType::Ptr builtin = Helper::builtinType(typeName);
+    QVERIFY(builtin);
+    DUChainReadLocker lock;
+    QList<Declaration*> decls = ctx->findDeclarations(QualifiedIdentifier("checkme"));
+    QCOMPARE(decls.size(), 1);
+    QVERIFY(decls.first()->abstractType());
+    QVERIFY(decls.first()->abstractType()->equals(builtin.data()));
+    QCOMPARE(builtin->toString(), typeName);
+}
+
+void PyDUChainTest::testBuiltinTypes_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<QString>("typeName");
+
+    QTest::newRow("int") << "checkme = 3" << "int";
+    QTest::newRow("str") << "checkme = 'foo'" << "str";
+    QTest::newRow("bool_literal") << "checkme = False" << "bool";
+    QTest::newRow("bool_comparison") << "checkme = 3 < 4" << "bool";
+    QTest::newRow("bool_operation") << "checkme = 3 < 4 or 5 > 6" << "bool";
+}
+
 void PyDUChainTest::testTypes_data()
 {
     QTest::addColumn<QString>("code");
@@ -789,6 +822,21 @@ void PyDUChainTest::testTypes_data()
 
     QTest::newRow("dict_assign_twice") << "d = dict(); d[''] = 0; d = dict(); d[''] = 0; checkme = d"
                                        << "unsure (dict of str : int, dict)";
+
+    QString manyClasses;
+    for ( int i = 0; i <= 16; i++ ) {
+        manyClasses += QString("class C%1: pass\ncheckme = C%1()\n").arg(i);
+    }
+    QTest::newRow("unsure_widened") << manyClasses << "object";
+    QTest::newRow("unsure_widened_stays") << manyClasses + "checkme = 3\ncheckme = 'a'\n" << "object";
+    QTest::newRow("unsure_object_not_widened") << "checkme = object()\ncheckme = 3" << "unsure (object, int)";
+
+    QStringList manyNumbers;
+    for ( int i = 0; i < 500; i++ ) {
+        manyNumbers << QString::number(i);
+    }
+    QTest::newRow("huge_tuple") << "t = (" + manyNumbers.join(", ") + ")\ncheckme = t[250]" << "int";
+    QTest::newRow("huge_list") << "checkme = [" + manyNumbers.join(", ") + "]" << "list of int";
     
     QTest::newRow("class_method_import") << "class c:\n attr = \"foo\"\n def m():\n  return attr;\n  return 3;\ni=c()\ncheckme=i.m()" << "int";
     QTest::newRow("getsListDecorator") << "foo = [1, 2, 3]\ncheckme = foo.reverse()" << "list of int";
@@ -1095,6 +1143,35 @@ void PyDUChainTest::testHintedTypes_data()
     QTest::newRow("unsure_attribute") << "def myfunc(x): return x.capitalize()\nmyfunc(3.5)\ncheckme = myfunc(str())" << "str";
 }
 
+void PyDUChainTest::testArgumentHintsPerPass()
+{
+    // Argument hints are stored at the end of each pass of the declaration builder;
+    // check that no call site gets lost by that.
+    QFETCH(QString, code);
+    QFETCH(QString, expectedType);
+    ReferencedTopDUContext ctx = parse(code);
+    QVERIFY(ctx);
+    DUChainReadLocker lock;
+    QList< Declaration* > decls = ctx->findDeclarations(KDevelop::Identifier("myfunc"));
+    QVERIFY(! decls.isEmpty());
+    DUContext* args = DUChainUtils::getArgumentContext(decls.first());
+    QVERIFY(args);
+    QCOMPARE(args->localDeclarations().size(), 1);
+    Declaration* parameter = args->localDeclarations().first();
+    QVERIFY(parameter->abstractType());
+    QCOMPARE(parameter->abstractType()->toString(), expectedType);
+}
+
+void PyDUChainTest::testArgumentHintsPerPass_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<QString>("expectedType");
+
+    QTest::newRow("all_calls") << "def myfunc(x): pass\nmyfunc(3)\nmyfunc(3.5)" << "unsure (int, float)";
+    QTest::newRow("call_before_function") << "myfunc(3)\ndef myfunc(x): pass" << "int";
+    QTest::newRow("call_before_class") << "def myfunc(x): pass\nmyfunc(B())\nclass B: pass" << "B";
+}
+
 void PyDUChainTest::testDecorators()
 {
     QFETCH(QString, code);
@@ -1339,3 +1416,66 @@ void PyDUChainTest::testVariableCreation_data()
                                                                                 << QStringList{"int", "int", "float"};
 }
 
+void PyDUChainTest::testMemoryUsage()
+{
+    ReferencedTopDUContext ctx = parse("class A: pass\n"
+                                       "def f(x): return [x, 3]\n"
+                                       "a = f(A())\n"
+                                       "b = (1, 2.5)\n"
+                                       "c = A() if a else 3\n"
+                                       "print(a, b, c)");
+    QVERIFY(ctx);
+    DUChainReadLocker lock;
+    MemoryUsage usage = DumpChain::memoryUsage(ctx.data());
+    QCOMPARE(usage.url, ctx->url());
+    QVERIFY(usage.declarations > 0);
+    QVERIFY(usage.contexts > 0);
+    QVERIFY(usage.uses > 0);
+    QVERIFY(usage.unsureTypes > 0);
+    QVERIFY(usage.indexedContainers > 0);
+    QVERIFY(usage.hintedTypes > 0);
+    QCOMPARE(usage.problems, 0u);
+}
+
+void PyDUChainTest::testContextRangeIndex()
+{
+    const QString code = "import os\n"
+                         "class A:\n"
+                         "    def f(self, x):\n"
+                         "        y = [z for z in x if z]\n"
+                         "\n"
+                         "\n"
+                         "        return lambda q: q + y\n"
+                         "    def g(self): pass\n"
+                         "\n"
+                         "def h(a, b=3):\n"
+                         "    class B:\n"
+                         "        c = {k: v for k, v in a}\n"
+                         "    return B\n"
+                         "\n"
+                         "x = A().f([1])\n";
+    ReferencedTopDUContext ctx = parse(code);
+    QVERIFY(ctx);
+    DUChainReadLocker lock;
+    ContextRangeIndex index(ctx.data());
+    const QStringList lines = code.split('\n');
+    for ( int line = 0; line < lines.size() + 1; line++ ) {
+        for ( int column = 0; column <= lines.value(line).size() + 1; column++ ) {
+            const CursorInRevision position(line, column);
+            QCOMPARE(index.contextAt(position, false), ctx->findContextAt(position, false));
+            QCOMPARE(index.contextAt(position, true), ctx->findContextAt(position, true));
+        }
+    }
+    for ( int line = 0; line < lines.size(); line++ ) {
+        DUContext* context = ctx->findContextAt(CursorInRevision(line, 8), true);
+        if ( ! context ) {
+            continue;
+        }
+        // what the completion context did before, one line at a time
+        int expected = line;
+        while ( expected >= 0 && ctx->findContextAt(CursorInRevision(expected, 0), true) == context ) {
+            expected--;
+        }
+        QCOMPARE(index.lastLineOutside(context, line), expected);
+    }
+}
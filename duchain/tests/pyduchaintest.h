@@ -58,6 +58,8 @@ class PyDUChainTest : public QObject
         void testRanges_data();
         void testTypes();
         void testTypes_data();
+        void testBuiltinTypes();
+        void testBuiltinTypes_data();
         void testImportDeclarations();
         void testImportDeclarations_data();
         void testCrashes();
@@ -95,6 +97,10 @@ class PyDUChainTest : public QObject
         void testProblemCount_data();
         void testHintedTypes();
         void testHintedTypes_data();
+        void testArgumentHintsPerPass();
+        void testArgumentHintsPerPass_data();
+        void testMemoryUsage();
+        void testContextRangeIndex();
 
 
     private:
@@ -28,6 +28,11 @@
 
 #include <KLocalizedString>
 
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QVector>
+
 using namespace KDevelop;
 
 namespace Python {
@@ -50,25 +55,71 @@ HintedType::HintedType(TypeAliasTypeData& data): TypeAliasType(data)
 
 }
 
-bool HintedType::isValid(TopDUContext* /*current*/)
+namespace {
+    // The current generation of each top context parsed in this session, by index of the context; 0 if none.
+    // The tables are only written while the DUChain is write-locked, and only read while it is locked,
+    // so checking a hint needs no lock of its own.
+    QVector<quint64> currentGenerations;
+    // the generation of the last parse which created each hint, by index of the hint type
+    QHash<uint, quint64> hintGenerations;
+    QAtomicInt generationCounter;
+
+    QMutex hintTargetsLock;
+    // declarations which received hints from a top context, by index of the creating context
+    QHash<uint, QSet<IndexedDeclaration>> hintTargets;
+}
+
+quint64 HintedType::newGeneration()
+{
+    return quint32(generationCounter.fetchAndAddOrdered(1) + 1);
+}
+
+void HintedType::setGeneration(const QVector<IndexedType>& hints, quint64 generation)
 {
+    ENSURE_CHAIN_WRITE_LOCKED
+    foreach ( const IndexedType& hint, hints ) {
+        hintGenerations[hint.index()] = generation;
+    }
+}
+
+void HintedType::setCurrentGeneration(const IndexedTopDUContext& context, quint64 generation)
+{
+    ENSURE_CHAIN_WRITE_LOCKED
+    if ( currentGenerations.size() <= int(context.index()) ) {
+        currentGenerations.resize(context.index() + 1);
+    }
+    currentGenerations[context.index()] = generation;
+}
+
+QList<IndexedDeclaration> HintedType::invalidateHints(const IndexedTopDUContext& context, quint64 generation)
+{
+    setCurrentGeneration(context, generation);
+    QMutexLocker lock(&hintTargetsLock);
+    return hintTargets.take(context.index()).toList();
+}
+
+void HintedType::registerHintTarget(const IndexedTopDUContext& creator, const IndexedDeclaration& target)
+{
+    QMutexLocker lock(&hintTargetsLock);
+    hintTargets[creator.index()].insert(target);
+}
+
+bool HintedType::isValid(const IndexedType& indexed)
+{
+    const uint creatorIndex = d_func()->m_createdByContext.index();
+    if ( creatorIndex < uint(currentGenerations.size()) && currentGenerations.at(creatorIndex) ) {
+        return hintGenerations.value(indexed.index()) == currentGenerations.at(creatorIndex);
+    }
+    // The creating context was not parsed in this session, check its modification revision.
     TopDUContext* creator = d_func()->m_createdByContext.data();
     if ( ! creator ) {
         return false;
     }
-    KDEBUG_BLOCK
     ModificationRevision rev(creator->parsingEnvironmentFile()->modificationRevision());
-    kDebug() << "current: " << rev.revision << "; created:" << d_func()->m_modificationRevision.revision;
-    kDebug() << "current: " << rev.modificationTime << "; created:" << d_func()->m_modificationRevision.modificationTime;
     if ( d_func()->m_modificationRevision < rev ) {
         kDebug() << "modification revision mismatch, invalidating";
         return false;
     }
-    /// This should not be needed any more since 193f52027fb7
-//     if ( creator == current && d_func()->m_modificationRevision == rev && rev.revision != 0 ) {
-//         kDebug() << "modification revision exact match, but same context, invalidating";
-//         return false;
-//     }
     return true;
 }
 
@@ -76,8 +127,6 @@ void HintedType::setCreatedBy(TopDUContext* context, const ModificationRevision&
 {
     d_func_dynamic()->m_createdByContext = context->indexed();
     d_func_dynamic()->m_modificationRevision = revision;
-    kDebug() << "new HintedType with modification time: " << d_func()->m_modificationRevision.modificationTime 
-             << "; " << d_func()->m_modificationRevision.revision;
 }
 
 KDevelop::AbstractType* HintedType::clone() const
@@ -28,6 +28,7 @@
 #include <language/duchain/types/typealiastype.h>
 #include <language/duchain/use.h>
 #include <language/duchain/topducontext.h>
+#include <language/duchain/indexeddeclaration.h>
 #include <language/editor/modificationrevision.h>
 
 using namespace KDevelop;
@@ -44,8 +45,7 @@ public:
     }
     /// Copy constructor. \param rhs data to copy
     HintedTypeData( const HintedTypeData& rhs )
-        : KDevelop::TypeAliasTypeData(rhs), m_createdByContext(rhs.m_createdByContext)
-        , m_modificationRevision(rhs.m_modificationRevision)
+        : KDevelop::TypeAliasTypeData(rhs), m_createdByContext(rhs.m_createdByContext), m_modificationRevision(rhs.m_modificationRevision)
     {
     }
     
@@ -85,10 +85,50 @@ public:
     /**
      * @brief Checks whether this hint is still valid, and returns false if it is not
      * @warning The DUChain must be at least read-locked for this
+     *
+     * If the creating context was parsed in this session, this only compares the generation of the hint
+     * with the current generation of that context; otherwise, the modification revision of the creating
+     * context is checked.
      * 
+     * @param indexed the index of this type, which the generation of the hint is looked up by
      * @return bool true if valid, false otherwise
      **/
-    bool isValid(TopDUContext* current);
+    bool isValid(const IndexedType& indexed);
+
+    /**
+     * @brief Get a new generation for the hints created by one parse job. Thread-safe.
+     *
+     * Generations only exist in memory; they are not part of the type, so the same hint created
+     * by two parses is stored only once, and the on-disk data of hints is not affected.
+     **/
+    static quint64 newGeneration();
+
+    /**
+     * @brief Record that the parse with @p generation created (or created again) the hints @p hints.
+     * @warning The DUChain must be write-locked.
+     **/
+    static void setGeneration(const QVector<IndexedType>& hints, quint64 generation);
+
+    /**
+     * @brief Make @p generation the current generation of @p context; hints with any other generation are invalid.
+     * @warning The DUChain must be write-locked.
+     **/
+    static void setCurrentGeneration(const IndexedTopDUContext& context, quint64 generation);
+
+    /**
+     * @brief Mark all hints created by @p context so far as invalid; call this when it is about to be parsed again.
+     *
+     * The hints created by the new parse must use @p generation.
+     * @return the declarations which received hints from @p context, see registerHintTarget().
+     * Their stale hints can be removed with Helper::removeStaleHints().
+     * @warning The DUChain must be write-locked.
+     **/
+    static QList<IndexedDeclaration> invalidateHints(const IndexedTopDUContext& context, quint64 generation);
+
+    /**
+     * @brief Remember that @p target got a type hint from @p creator, so it can be cleaned up later.
+     **/
+    static void registerHintTarget(const IndexedTopDUContext& creator, const IndexedDeclaration& target);
     
     virtual bool equals(const AbstractType* rhs) const;
     
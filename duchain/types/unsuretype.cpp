@@ -28,6 +28,10 @@
 #include <language/duchain/types/typealiastype.h>
 #include <language/duchain/types/unsuretype.h>
 
+#include <QSet>
+
+#include <algorithm>
+
 namespace Python {
     
 REGISTER_TYPE(UnsureType);
@@ -63,11 +67,46 @@ const QList<AbstractType::Ptr> UnsureType::typesRecursive() const
     return results;
 }
 
+bool UnsureType::addTypes(const QVector<IndexedType>& types, uint maxSize)
+{
+    // Only the added types are sorted; the members are looked up in them, so adding
+    // a few types to a big unsure type costs one pass over its members.
+    QVector<uint> added;
+    added.reserve(types.size());
+    foreach ( const IndexedType& type, types ) {
+        added.append(type.index());
+    }
+    std::sort(added.begin(), added.end());
+    added.erase(std::unique(added.begin(), added.end()), added.end());
+
+    QVector<bool> known(added.size(), false);
+    int newCount = added.size();
+    FOREACH_FUNCTION ( const IndexedType& type, d_func()->m_types ) {
+        auto it = std::lower_bound(added.begin(), added.end(), type.index());
+        if ( it != added.end() && *it == type.index() && ! known[it - added.begin()] ) {
+            known[it - added.begin()] = true;
+            newCount--;
+        }
+    }
+    if ( typesSize() + newCount > maxSize ) {
+        return false;
+    }
+    foreach ( const IndexedType& type, types ) {
+        const int position = std::lower_bound(added.begin(), added.end(), type.index()) - added.begin();
+        if ( known[position] ) {
+            continue;
+        }
+        known[position] = true;
+        d_func_dynamic()->m_typesList().append(type);
+    }
+    return true;
+}
+
 QString UnsureType::toString() const
 {
     QString typeList;
     int count = 0;
-    QList<IndexedType> encountered;
+    QSet<uint> encountered;
     foreach ( AbstractType::Ptr type, typesRecursive() ) {
         if ( ! type ) {
             kWarning() << "Invalid type: " << type.unsafeData();
@@ -75,9 +114,9 @@ QString UnsureType::toString() const
         }
         
         IndexedType indexed = Helper::resolveAliasType(type)->indexed();
-        if ( encountered.contains(indexed) )
+        if ( encountered.contains(indexed.index()) )
             continue;
-        encountered << indexed;
+        encountered.insert(indexed.index());
         
         if ( count )
             typeList += ", ";
@@ -50,6 +50,15 @@ public:
     virtual uint hash() const;
     virtual QString toString() const;
     const QList<AbstractType::Ptr> typesRecursive() const;
+
+    /**
+     * @brief Append those of @p types which are not contained in this type yet, keeping their order.
+     *
+     * Duplicates are found by looking up each member in the sorted indices of @p types,
+     * so the members themselves are neither searched repeatedly nor sorted.
+     * @return false (and leaves the type unchanged) if the result would have more than @p maxSize members
+     **/
+    bool addTypes(const QVector<IndexedType>& types, uint maxSize);
     
     virtual bool equals(const AbstractType* rhs) const;
     
@@ -48,7 +48,10 @@ DUContext* UseBuilder::contextAtOrCurrent(const CursorInRevision& pos)
     DUContext* context = 0;
     {
         DUChainReadLocker lock;
-        context = topContext()->findContextAt(pos, true);
+        if ( ! m_contextIndex || m_contextIndex->topContext() != topContext() ) {
+            m_contextIndex.reset(new ContextRangeIndex(topContext()));
+        }
+        context = m_contextIndex->contextAt(pos, true);
     }
     if ( ! context ) {
         context = currentContext();
@@ -114,6 +117,9 @@ void UseBuilder::visitAttribute(AttributeAst* node)
 
     DUContext* context = contextAtOrCurrent(editorFindPositionSafe(node));
     ExpressionVisitor v(context);
+    // The base class visitor above already evaluated all the inner parts of the attribute chain;
+    // with the cache, only the outermost access needs to be computed here.
+    v.setCache(expressionCache());
     v.visitNode(node);
     RangeInRevision useRange(node->attribute->startLine, node->attribute->startCol,
                              node->attribute->endLine, node->attribute->endCol + 1);
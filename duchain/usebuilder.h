@@ -23,9 +23,12 @@
 #include "pythonduchainexport.h"
 #include "pythoneditorintegrator.h"
 #include "ast.h"
+#include "contextrangeindex.h"
 
 #include <language/duchain/builders/abstractusebuilder.h>
 
+#include <QScopedPointer>
+
 namespace Python {
 
 class ParseSession;
@@ -56,6 +59,8 @@ private:
         m_errorReportingEnabled = true;
     };
     DUContext* contextAtOrCurrent(const CursorInRevision& pos);
+    /// the contexts don't change while uses are built, so this is built once on the first lookup
+    QScopedPointer<ContextRangeIndex> m_contextIndex;
 };
 
 }
@@ -32,6 +32,7 @@
 #include <QDir>
 #include <QTimer>
 #include <QMutexLocker>
+#include <QSet>
 #include <language/duchain/topducontext.h>
 #include <language/duchain/problem.h>
 #include <language/duchain/duchain.h>
@@ -576,5 +577,244 @@ CodeAst::Ptr AstBuilder::parse(KUrl filename, QString &contents)
     return CodeAst::Ptr(t.ast);
 }
 
+namespace {
+/// Recursive descent parser for the expressions accepted by AstBuilder::parseSimpleExpression().
+class SimpleExpressionParser {
+public:
+    SimpleExpressionParser(const QString& code)
+        : m_code(code), m_pos(0) { }
+
+    ~SimpleExpressionParser() {
+        // nodes are only left here if parsing failed
+        qDeleteAll(m_nodes);
+    }
+
+    CodeAst::Ptr parse() {
+        CodeAst::Ptr code(new CodeAst);
+        ExpressionAst* statement = create<ExpressionAst>(code.data());
+        statement->value = parseExpression(statement);
+        skipWhitespace();
+        if ( ! statement->value || m_pos != m_code.size() ) {
+            return CodeAst::Ptr();
+        }
+        statement->startLine = statement->endLine = 0;
+        statement->startCol = statement->value->startCol;
+        statement->endCol = statement->value->endCol;
+        code->body << statement;
+        m_nodes.clear();
+        return code;
+    }
+
+private:
+    template<typename T> T* create(Ast* parent) {
+        T* node = new T(parent);
+        m_nodes << node;
+        return node;
+    }
+
+    Identifier* createIdentifier(Ast* parent, const QString& name, int start) {
+        Identifier* identifier = new Identifier(name);
+        m_nodes << identifier;
+        identifier->parent = parent;
+        identifier->startLine = identifier->endLine = 0;
+        identifier->startCol = start;
+        identifier->setEndColumn();
+        identifier->hasUsefulRangeInformation = true;
+        return identifier;
+    }
+
+    void setRange(Ast* node, int start) {
+        node->startLine = node->endLine = 0;
+        node->startCol = start;
+        node->endCol = m_pos - 1;
+    }
+
+    void skipWhitespace() {
+        while ( m_pos < m_code.size() && m_code.at(m_pos).isSpace() ) {
+            m_pos++;
+        }
+    }
+
+    bool isIdentifierChar(int pos) const {
+        return pos < m_code.size() && ( m_code.at(pos).isLetterOrNumber() || m_code.at(pos) == '_' );
+    }
+
+    QString readName() {
+        const int start = m_pos;
+        if ( m_pos < m_code.size() && ! m_code.at(m_pos).isDigit() ) {
+            while ( isIdentifierChar(m_pos) ) {
+                m_pos++;
+            }
+        }
+        return m_code.mid(start, m_pos - start);
+    }
+
+    static bool isKeyword(const QString& name) {
+        static const QSet<QString> keywords = QSet<QString>()
+            << "and" << "as" << "assert" << "break" << "class" << "continue" << "def" << "del"
+            << "elif" << "else" << "except" << "finally" << "for" << "from" << "global" << "if"
+            << "import" << "in" << "is" << "lambda" << "nonlocal" << "not" << "or" << "pass"
+            << "raise" << "return" << "try" << "while" << "with" << "yield";
+        return keywords.contains(name);
+    }
+
+    ExpressionAst* parseAtom(Ast* parent) {
+        skipWhitespace();
+        if ( m_pos >= m_code.size() ) {
+            return nullptr;
+        }
+        const int start = m_pos;
+        const QChar c = m_code.at(m_pos);
+        if ( c.isDigit() ) {
+            while ( m_pos < m_code.size() && m_code.at(m_pos).isDigit() ) {
+                m_pos++;
+            }
+            bool isInt = true;
+            if ( m_pos + 1 < m_code.size() && m_code.at(m_pos) == '.' && m_code.at(m_pos + 1).isDigit() ) {
+                isInt = false;
+                m_pos++;
+                while ( m_pos < m_code.size() && m_code.at(m_pos).isDigit() ) {
+                    m_pos++;
+                }
+            }
+            // exponents, hex numbers, imaginary numbers, "3.real", ...
+            if ( isIdentifierChar(m_pos) || ( m_pos < m_code.size() && m_code.at(m_pos) == '.' ) ) {
+                return nullptr;
+            }
+            NumberAst* number = create<NumberAst>(parent);
+            number->isInt = isInt;
+            number->value = isInt ? m_code.mid(start, m_pos - start).toLong() : 0;
+            setRange(number, start);
+            return number;
+        }
+        if ( c == '"' || c == '\'' ) {
+            const int end = m_code.indexOf(c, m_pos + 1);
+            if ( end == -1 ) {
+                return nullptr;
+            }
+            const QString value = m_code.mid(m_pos + 1, end - m_pos - 1);
+            if ( value.contains('\\') || value.contains('\n') ) {
+                return nullptr;
+            }
+            m_pos = end + 1;
+            StringAst* string = create<StringAst>(parent);
+            string->value = value;
+            setRange(string, start);
+            return string;
+        }
+        const QString name = readName();
+        if ( name.isEmpty() ) {
+            return nullptr;
+        }
+        if ( name == "True" || name == "False" || name == "None" ) {
+            NameConstantAst* constant = create<NameConstantAst>(parent);
+            constant->value = name == "True" ? NameConstantAst::True
+                              : ( name == "False" ? NameConstantAst::False : NameConstantAst::None );
+            setRange(constant, start);
+            return constant;
+        }
+        if ( isKeyword(name) ) {
+            return nullptr;
+        }
+        NameAst* nameAst = create<NameAst>(parent);
+        nameAst->identifier = createIdentifier(nameAst, name, start);
+        nameAst->context = ExpressionAst::Load;
+        setRange(nameAst, start);
+        nameAst->hasUsefulRangeInformation = true;
+        return nameAst;
+    }
+
+    ExpressionAst* parseExpression(Ast* parent) {
+        ExpressionAst* result = parseAtom(parent);
+        const int start = result ? result->startCol : m_pos;
+        while ( result ) {
+            skipWhitespace();
+            if ( m_pos >= m_code.size() ) {
+                break;
+            }
+            const QChar c = m_code.at(m_pos);
+            if ( c == '.' ) {
+                m_pos++;
+                skipWhitespace();
+                const int nameStart = m_pos;
+                const QString name = readName();
+                if ( name.isEmpty() || isKeyword(name) ) {
+                    return nullptr;
+                }
+                AttributeAst* attribute = create<AttributeAst>(parent);
+                attribute->value = result;
+                result->parent = attribute;
+                attribute->attribute = createIdentifier(attribute, name, nameStart);
+                attribute->context = ExpressionAst::Load;
+                setRange(attribute, start);
+                attribute->hasUsefulRangeInformation = true;
+                result = attribute;
+            }
+            else if ( c == '(' ) {
+                m_pos++;
+                CallAst* call = create<CallAst>(parent);
+                call->function = result;
+                result->parent = call;
+                result->belongsToCall = call;
+                skipWhitespace();
+                while ( m_pos < m_code.size() && m_code.at(m_pos) != ')' ) {
+                    ExpressionAst* argument = parseExpression(call);
+                    if ( ! argument ) {
+                        return nullptr;
+                    }
+                    call->arguments << argument;
+                    skipWhitespace();
+                    if ( m_pos < m_code.size() && m_code.at(m_pos) == ',' ) {
+                        m_pos++;
+                        skipWhitespace();
+                    }
+                    else if ( m_pos < m_code.size() && m_code.at(m_pos) != ')' ) {
+                        // keyword arguments, operators, generators, ...
+                        return nullptr;
+                    }
+                }
+                if ( m_pos >= m_code.size() ) {
+                    return nullptr;
+                }
+                m_pos++;
+                setRange(call, start);
+                result = call;
+            }
+            else if ( c == '[' ) {
+                m_pos++;
+                SubscriptAst* subscript = create<SubscriptAst>(parent);
+                subscript->value = result;
+                result->parent = subscript;
+                IndexAst* index = create<IndexAst>(subscript);
+                index->value = parseExpression(index);
+                skipWhitespace();
+                if ( ! index->value || m_pos >= m_code.size() || m_code.at(m_pos) != ']' ) {
+                    return nullptr;
+                }
+                m_pos++;
+                subscript->slice = index;
+                subscript->context = ExpressionAst::Load;
+                setRange(subscript, start);
+                result = subscript;
+            }
+            else {
+                break;
+            }
+        }
+        return result;
+    }
+
+    const QString m_code;
+    int m_pos;
+    QList<Ast*> m_nodes;
+};
+}
+
+CodeAst::Ptr AstBuilder::parseSimpleExpression(const QString& expression)
+{
+    SimpleExpressionParser parser(expression);
+    return parser.parse();
+}
+
 }
 
@@ -55,6 +55,15 @@ class KDEVPYTHONPARSER_EXPORT AstBuilder
 {
 public:
     CodeAst::Ptr parse(KUrl filename, QString &contents);
+
+    /**
+     * @brief Build the tree for a single expression made of names, literals, attribute accesses,
+     * calls and subscripts, like "self.foo.bar(3)[0]", without using the python interpreter.
+     *
+     * @return the tree parse() would create for the expression, or a null pointer
+     *         if the expression contains anything else
+     **/
+    static CodeAst::Ptr parseSimpleExpression(const QString& expression);
     QList<KDevelop::ProblemPointer> m_problems;
 private:
     static QMutex pyInitLock;
@@ -58,6 +58,11 @@ FileIndentInformation::FileIndentInformation(const QByteArray& data)
     initialize(QString(data.data()).split('\n'));
 }
 
+FileIndentInformation::FileIndentInformation(const QList<int>& indents)
+    : m_indents(indents)
+{
+}
+
 FileIndentInformation::FileIndentInformation(KTextEditor::Document* document)
 {
     QStringList lines;
@@ -166,11 +171,27 @@ CodeHelpers::EndLocation CodeHelpers::endsInside(const QString &code)
 }
 
 QString CodeHelpers::killStrings(QString stringWithStrings)
+{
+    const QList<QPair<int, int>> strings = findStrings(stringWithStrings);
+    // replace back to front, so the positions of the remaining strings stay valid
+    for ( int i = strings.size() - 1; i >= 0; i-- ) {
+        stringWithStrings.replace(strings.at(i).first, strings.at(i).second, "\"S\"");
+    }
+    return stringWithStrings;
+}
+
+QList<QPair<int, int>> CodeHelpers::findStrings(const QString& code, int from)
 {
     QRegExp replaceStrings("(\".*\"|\'.*\'|\"\"\".*\"\"\"|\'\'\'.*\'\'\')");
     replaceStrings.setMinimal(true);
-    QString stripped = stringWithStrings.replace(replaceStrings, "\"S\"");
-    return stripped;
+    QList<QPair<int, int>> strings;
+    int index = from;
+    while ( ( index = replaceStrings.indexIn(code, index) ) != -1 ) {
+        const int length = replaceStrings.matchedLength();
+        strings.append(qMakePair(index, length));
+        index += length;
+    }
+    return strings;
 }
 
 QString CodeHelpers::expressionUnderCursor(Python::LazyLineFetcher& lineFetcher, KTextEditor::Cursor cursor, bool forceScanExpression)
@@ -20,6 +20,7 @@
 #ifndef CODEHELPERS_H
 #define CODEHELPERS_H
 #include <QString>
+#include <QPair>
 #include <KTextEditor/Document>
 #include "parserexport.h"
 
@@ -59,6 +60,8 @@ public:
     FileIndentInformation(KTextEditor::Document* document);
     FileIndentInformation(const QByteArray& data);
     FileIndentInformation(const QString& data);
+    /// @param indents the indent of each line, as computed for the other constructors
+    FileIndentInformation(const QList<int>& indents);
     
     enum ScanDirection {
         Forward,
@@ -108,6 +111,15 @@ class KDEVPYTHONPARSER_EXPORT CodeHelpers
          * @return QString the input code, with all strings replaced by "S", so 'foo("fancy\"\"\"''__/string")' -> 'foo("S")'
          **/
         static QString killStrings(QString stringWithStrings);
+
+        /**
+         * @brief Find the strings which killStrings() replaces, starting the search at @p from.
+         *
+         * @param code some python code which may contain strings
+         * @param from the position in @p code to start searching at
+         * @return the start and length of each string found, in order
+         **/
+        static QList<QPair<int, int>> findStrings(const QString& code, int from = 0);
         
         /**
          * @brief Check whether the given code ends inside a comment.
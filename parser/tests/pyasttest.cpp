@@ -267,3 +267,60 @@ void PyAstTest::testClass()
     testCode("class c: pass");
 }
 
+class StructureVisitor : public AstDefaultVisitor {
+public:
+    virtual void visitNode(Ast* node) {
+        if ( node ) {
+            structure << QString::number(node->astType);
+        }
+        AstDefaultVisitor::visitNode(node);
+    };
+    virtual void visitIdentifier(Identifier* node) {
+        structure << node->value;
+    };
+    virtual void visitNumber(NumberAst* node) {
+        structure << ( node->isInt ? QString::number(node->value) : "float" );
+    };
+    virtual void visitString(StringAst* node) {
+        structure << node->value;
+    };
+    QStringList structure;
+};
+
+void PyAstTest::testSimpleExpressions()
+{
+    QFETCH(QString, code);
+    QFETCH(bool, supported);
+    CodeAst::Ptr simple = AstBuilder::parseSimpleExpression(code);
+    QCOMPARE(static_cast<bool>(simple), supported);
+    if ( ! supported ) {
+        return;
+    }
+    StructureVisitor expected;
+    expected.visitCode(getAst(code).data());
+    StructureVisitor actual;
+    actual.visitCode(simple.data());
+    QCOMPARE(actual.structure, expected.structure);
+}
+
+void PyAstTest::testSimpleExpressions_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<bool>("supported");
+    QTest::newRow("name") << "foo" << true;
+    QTest::newRow("attributes") << "self.foo.bar" << true;
+    QTest::newRow("call") << "foo.bar(3, baz, 'x')" << true;
+    QTest::newRow("subscript") << "foo[0].bar()[1.5]" << true;
+    QTest::newRow("nested_calls") << "foo(bar(baz(bang[\"x\"])))" << true;
+    QTest::newRow("string_attribute") << "\"abc\".join" << true;
+    QTest::newRow("constants") << "f(True, None)" << true;
+    QTest::newRow("whitespace") << "foo . bar ( 3 )" << true;
+    QTest::newRow("operator") << "a + b" << false;
+    QTest::newRow("keyword_argument") << "foo(a=3)" << false;
+    QTest::newRow("slice") << "foo[1:2]" << false;
+    QTest::newRow("list") << "[1, 2]" << false;
+    QTest::newRow("lambda") << "lambda: 3" << false;
+    QTest::newRow("escape") << "'a\\'b'" << false;
+    QTest::newRow("hex") << "0x10" << false;
+    QTest::newRow("unfinished") << "foo(bar" << false;
+}
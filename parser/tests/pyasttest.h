@@ -53,6 +53,8 @@ private slots:
     void testExceptionHandlers();
     void testCorrectedFuncRanges();
     void testCorrectedFuncRanges_data();
+    void testSimpleExpressions();
+    void testSimpleExpressions_data();
 };
 
 }
@@ -27,6 +27,7 @@
 #include <KStandardDirs>
 #include <KPluginFactory>
 #include <KPluginLoader>
+#include <KConfigGroup>
 
 #include <interfaces/icore.h>
 #include <interfaces/ilanguagecontroller.h>
@@ -49,6 +50,7 @@
 #include "pythonparsejob.h"
 #include "pythonhighlighting.h"
 #include "duchain/pythoneditorintegrator.h"
+#include "duchain/helpers.h"
 #include "codecompletion/model.h"
 #include "codegen/refactoring.h"
 #include "codegen/correctionfilegenerator.h"
@@ -91,6 +93,10 @@ LanguageSupport::LanguageSupport( QObject* parent, const QVariantList& /*args*/
 
     m_self = this;
 
+    KConfig config("kdevpythonsupportrc");
+    KConfigGroup parsing = config.group("parsing");
+    Helper::maxUnsureTypes = qMax(2, parsing.readEntry<int>("maxUnsureTypes", Helper::defaultMaxUnsureTypes));
+
     m_highlighting = new Highlighting( this );
     m_refactoring = new Refactoring(this);
     PythonCodeCompletionModel* codeCompletion = new PythonCodeCompletionModel(this);
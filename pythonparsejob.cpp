@@ -26,6 +26,9 @@
 #include "pythonlanguagesupport.h"
 #include "declarationbuilder.h"
 #include "usebuilder.h"
+#include "expressioncache.h"
+#include "helpers.h"
+#include "types/hintedtype.h"
 #include "checks/controlflowgraphbuilder.h"
 #include "checks/dataaccessvisitor.h"
 #include "kshell.h"
@@ -64,6 +67,20 @@ using namespace KDevelop;
 namespace Python
 {
 
+namespace {
+    /// Drops the outdated hints from the declarations which got them when the parse job returns,
+    /// also when it is aborted, instead of filtering them on each access.
+    struct StaleHintsRemover {
+        QList<IndexedDeclaration> targets;
+        ~StaleHintsRemover() {
+            if ( ! targets.isEmpty() ) {
+                DUChainWriteLocker lock;
+                Helper::removeStaleHints(targets);
+            }
+        }
+    };
+}
+
 ParseJob::ParseJob(const IndexedString &url, ILanguageSupport* languageSupport)
         : KDevelop::ParseJob(url, languageSupport)
         , m_ast(0)
@@ -102,7 +119,8 @@ void ParseJob::run()
             if ( file->language() != langString ) {
                 continue;
             }
-            if ( ! file->needsUpdate() && file->featuresSatisfied(minimumFeatures()) && file->topContext() ) {
+            const auto features = static_cast<TopDUContext::Features>(minimumFeatures() | Helper::StoresDocstringHints);
+            if ( ! file->needsUpdate() && file->featuresSatisfied(features) && file->topContext() ) {
                 qDebug() << " ====> NOOP    ====> Already up to date:" << document().str();
                 setDuChain(file->topContext());
                 if ( ICore::self()->languageController()->backgroundParser()->trackerForUrl(document()) ) {
@@ -120,9 +138,14 @@ void ParseJob::run()
         DUChainReadLocker lock;
         toUpdate = DUChainUtils::standardContextForUrl(document().toUrl());
     }
+    // type hints this document created during previous parses are outdated from now on
+    const quint64 hintGeneration = HintedType::newGeneration();
+    StaleHintsRemover staleHints;
     if ( toUpdate ) {
         translateDUChainToRevision(toUpdate);
         toUpdate->setRange(RangeInRevision(0, 0, INT_MAX, INT_MAX));
+        DUChainWriteLocker lock;
+        staleHints.targets = HintedType::invalidateHints(toUpdate->indexed(), hintGeneration);
     }
     
     m_currentSession = new ParseSession();
@@ -137,13 +160,25 @@ void ParseJob::run()
     // if parsing succeeded, continue and do semantic analysis
     if ( parserResults.second )
     {
+        // cached lookups which depend on this document are invalid while it is being built
+        Helper::DocumentUpdate update(document());
+
+        // results of expression evaluation are shared between the builders of this job
+        ExpressionCache expressionCache;
+
         // set up the declaration builder, it gets the parsePriority so it can re-schedule imported files with a better priority
         DeclarationBuilder builder(editor.data(), parsePriority());
         builder.setCurrentlyParsedDocument(document());
         builder.setFutureModificationRevision(contents().modification);
+        builder.setExpressionCache(&expressionCache);
+        builder.setHintGeneration(hintGeneration);
 
         // Run the declaration builder. If necessary, it will run itself again.
         m_duContext = builder.build(document(), m_ast.data(), toUpdate.data());
+        if ( document() == IndexedString(Helper::getDocumentationFile()) ) {
+            // the builtin types might have changed
+            Helper::invalidateBuiltinTypes();
+        }
         if ( abortRequested() ) {
             return abortJob();
         }
@@ -151,9 +186,13 @@ void ParseJob::run()
         setDuChain(m_duContext);
         
         // gather uses of variables and functions on the document
+        // the declarations are final now, so cached results can be kept during the whole use building pass
+        expressionCache.clear();
         UseBuilder usebuilder(editor.data());
         usebuilder.setCurrentlyParsedDocument(document());
+        usebuilder.setExpressionCache(&expressionCache);
         usebuilder.buildUses(m_ast.data());
+        qDebug() << "Expression cache:" << expressionCache.hits() << "hits," << expressionCache.misses() << "misses";
         
         // check whether any unresolved imports were encountered
         bool needsReparse = ! builder.unresolvedImports().isEmpty();
@@ -183,7 +222,9 @@ void ParseJob::run()
         // some internal housekeeping work
         {
             DUChainWriteLocker lock(DUChain::lock());
-            m_duContext->setFeatures(minimumFeatures());
+            // a new document has no generation yet; its hints don't need the revision check from now on
+            HintedType::setCurrentGeneration(m_duContext->indexed(), hintGeneration);
+            m_duContext->setFeatures(static_cast<TopDUContext::Features>(minimumFeatures() | Helper::StoresDocstringHints));
             ParsingEnvironmentFilePointer parsingEnvironmentFile = m_duContext->parsingEnvironmentFile();
             parsingEnvironmentFile->setModificationRevision(contents().modification);
             DUChain::self()->updateContextEnvironment(m_duContext, parsingEnvironmentFile.data());